@@ -23,11 +23,15 @@
 #include  <SerialFlash.h>
 #include  <EEPROM.h>
 #include  "audioAnalyzer.h"
+#include  "bandEnvelope.h"
 #include  "devconf.h"
 #include  "display.h"
-
-#define  FASTLED_INTERNAL
-#include "FastLED.h"
+#include  "ledOutput.h"
+#include  "onsetDetector.h"
+#include  "pitchTracker.h"
+#include  "renderScheduler.h"
+#include  "settings.h"
+#include  "telemetry.h"
 
 // Set project identification here
 const char  Version[] = "Visyual Ear. V2.0";
@@ -35,9 +39,11 @@ const char  Branch[]  = "Main";
 const char  Description[]  = "104 Bands.  43Hz to 16744 Hz";
 
 // -- LED Display Constants
-#define START_NOISE_FLOOR   60  // Frequency Bin Magnitudes below this value will not get summed into Bands. (Initial high value)  was 80
-#define BASE_NOISE_FLOOR    40  // Frequency Bin Magnitudes below this value will not get summed into Bands. (Final minimumm value)
+#define START_NOISE_FLOOR   60  // Starting noise threshold of the lowest band.  Each band starts a little lower.  was 80
+#define BASE_NOISE_FLOOR    40  // Frequency Bin Magnitudes below this value will never get summed into Bands, however quiet the room.
 
+#define DARK_FRAMES        3  // Silent frames to keep rendering after the display goes dark, so the last fade is shown
+#define STATS_REPORT_MS  10000  // Time between render rate reports
 #define UI_HOLD_MS      3000
 #define UI_STEP_MS       200
 #define UI_BUTTON_PIN      3
@@ -50,18 +56,20 @@ float     downGainAccumulator = 0;
 
 // -- LED Display Data
 uint32_t  bandValues[NUM_BANDS];
-uint16_t  LO_bandBins[NUM_LO_BANDS + 1] = {13,14,15,16,17,18,20,21,22,23,25,26,28,29,31,33,35,37,39,41,44,46,49,52,55,58};
-uint16_t  MD_bandBins[NUM_MD_BANDS + 1] = {29,31,33,35,37,39,41,44,46,49,52,55,58,62,66,70,74,78,83,88,93,98,104,110,117,124,131,139,147,156,165,175};
-uint16_t  HI_bandBins[NUM_HI_BANDS + 1] = {25,27,28,30,32,33,35,37,40,42,45,47,50,53,56,60,63,67,71,75,79,84,89,94,100,106,112,119,126,134,142,150,159,168,178,189,200,212,225,238,252,267,283,300,318,337,357,378,400};
+uint32_t  envelopeValues[NUM_BANDS];
+uint32_t  renderValues[NUM_BANDS];
+FrameStamp bandStamp;
+FrameStamp renderStamp;
+uint16_t  LO_bandBins[NUM_LO_BANDS + 1] = LO_BAND_BINS;
+uint16_t  MD_bandBins[NUM_MD_BANDS + 1] = MD_BAND_BINS;
+uint16_t  HI_bandBins[NUM_HI_BANDS + 1] = HI_BAND_BINS;
 
 // Create the Audio components.  These should be created in the
 AudioInputI2S          audioInput;     // audio shield: mic or line-in
-AudioAnalyzeFFT        myFFT;
-AudioAnalyzePeak       peak;          //xy=393,385
+AudioAnalyzeFFT        myFFT;         // also measures the signal level for the VU meter
 
 // Connect the live input
 AudioConnection patchCord1(audioInput, 0, myFFT, 0);
-AudioConnection patchCord2(audioInput, 0, peak, 0);
 
 unsigned long startTime = millis();
 unsigned long lastTime = millis();
@@ -74,6 +82,13 @@ bool          UIButton  = false;
 bool          lastUIButton  = false;      
 
 int           activeBands = 0;
+uint8_t       analysisQuality = QUALITY_FULL;
+uint32_t      gateCloses  = 0;
+uint16_t      darkFrames  = 0;        // Silent frames since the display went dark
+uint32_t      sleptFrames = 0;        // Frames with no band or LED work, because of the silence gate
+uint32_t      statsReportMs = 0;
+uint32_t      reportBins[LATENCY_BINS];           // Copies of the latency histogram and trace, for reportLatency()
+FrameStamp    reportTrace[LATENCY_TRACE_FRAMES];
 
 // Non Volatile values
 short         gainNumber  = 0;
@@ -89,24 +104,40 @@ void setup() {
   AudioMemory(NUM_BURSTS);
 
   // read NV Ram
-  setDisplayMode( EEPROM.read(MODE_ADDRESS));
-  setGain(EEPROM.read(GAIN_ADDRESS));
+  initSettings();
+  setDisplayMode(getSetting(SETTING_MODE));
+  setGain(getSetting(SETTING_GAIN));
+  initNoiseFloor();
+  if (ZOOM_CENTRE_HZ > 0) {
+    myFFT.setZoom(ZOOM_CENTRE_HZ, ZOOM_DECIMATION_NUM);
+  }
   Serial.println(Version);
   Serial.println(Branch);
   Serial.println(Description);
   delay(500);
 
+  initLEDOutput();
+  initEnvelope();
+  initOnsets();
+  initPitchTracker();
+  initRenderScheduler();
+  initTelemetry();
   initDisplay();
 }
 
 void loop() {
-  // check the button and see if we have a change
+  // keep the LED transmitter fed, then check the button and see if we have a change
+  serviceLEDOutput();
+  serviceSettings();
   runUI();
+  reportQuality();
 
   if (getDisplayMode() == 1) {       
-    if (peak.available()){
-      updateVuDisplay(peak.readPeakToPeak());
+    if (myFFT.available()){
+      stampLEDs(myFFT.readStamp());
+      updateVuDisplay(myFFT.readLevel().peakToPeak);
     }
+    idleRenders();
   } else {       
     if (myFFT.available()) {
       // each time new FFT data is available update the diplay
@@ -114,9 +145,53 @@ void loop() {
       cycleTime = startTime - lastTime;
       lastTime = startTime;
   
-      fillBands();
-      updateDisplay(bandValues);
-      runAGC();
+      // a silent frame has no bands.  Once the display has gone dark there is nothing to do.
+      bool silent = myFFT.isSilent();
+      if (silent) {
+        memset(bandValues, 0, sizeof(bandValues));
+        activeBands = 0;
+      } else {
+        fillBands();
+      }
+
+      bool lit = runEnvelope(bandValues, envelopeValues);
+      if (silent && !lit && displayIdle()) {
+        if (darkFrames < DARK_FRAMES) {
+          darkFrames++;
+          if (darkFrames == DARK_FRAMES) {
+            // the tracker is not run while dark, so start afresh when the sound returns
+            resetPitchTracker();
+          }
+        }
+      } else {
+        darkFrames = 0;
+      }
+
+      if (darkFrames < DARK_FRAMES) {
+        bandStamp = myFFT.readStamp();
+        bandStamp.bandsUs = latencyNow();
+        runOnsets(bandValues, bandStamp.blockUs);
+        runPitchTracker(myFFT, bandStamp.blockUs);
+        publishBands(envelopeValues, bandStamp);
+        if (!silent) {
+          runAGC();
+        }
+
+        if (TELEMETRY_ENABLED) {
+          sendTelemetry(bandValues);
+        }
+      } else {
+        sleptFrames++;
+      }
+    }
+
+    // render at the display rate, in between analysis frames
+    if (darkFrames >= DARK_FRAMES) {
+      idleRenders();
+    } else if (renderDue()) {
+      interpolateBands(renderValues, renderStamp);
+      stampLEDs(renderStamp);
+      updateDisplay(renderValues);
     }
   }
 }
@@ -200,7 +275,7 @@ void  bumpGain(int step ) {
 
 void  bumpMode() {
   buttonStart = millis();
-  EEPROM.write(MODE_ADDRESS, switchDisplayMode());
+  putSetting(SETTING_MODE, switchDisplayMode());
   initDisplay();  
 }
 
@@ -214,7 +289,7 @@ double        gainScale;
     newgain = MAX_GAIN_NUM;
 
   gainNumber = newgain;
-  EEPROM.write(GAIN_ADDRESS, gainNumber);
+  putSetting(SETTING_GAIN, gainNumber);
 
   gainScale  = minScale * pow(gainSlope, gainNumber);
   myFFT.setInputScale(gainScale);
@@ -229,56 +304,150 @@ double        gainScale;
   return gainNumber;
 }
 
+// Report when the analyser changes its quality to keep up with the audio, or the silence gate closes,
+// and the render and analysis rates every STATS_REPORT_MS.  Not while telemetry owns the serial port.
+void  reportQuality() {
+  AnalysisStatus status = myFFT.readStatus();
+
+  if ((millis() - statsReportMs) >= STATS_REPORT_MS) {
+    statsReportMs = millis();
+    if (!TELEMETRY_ENABLED) {
+      RenderStats render;
+      readRenderStats(render);
+      Serial.print("Render Hz ");
+      Serial.print(render.renderRate);
+      Serial.print(", Analysis Hz ");
+      Serial.print(render.analysisRate);
+      Serial.print(", Dropped Renders ");
+      Serial.print(render.droppedRenders);
+      Serial.print(", Stale Frames ");
+      Serial.print(render.staleFrames);
+      Serial.print(", LED Frames Dropped ");
+      Serial.println(ledFramesDropped());
+      reportLatency();
+    }
+  }
+
+  if (status.gateCloses != gateCloses) {
+    gateCloses = status.gateCloses;
+    if (!TELEMETRY_ENABLED) {
+      Serial.print("Silent, Gated Sec ");
+      Serial.print(status.silentFrames * (ANALYSIS_INTERVAL_US / 1000000.0));
+      Serial.print(", Slept Frames ");
+      Serial.println(sleptFrames);
+    }
+  }
+
+  if (status.quality != analysisQuality) {
+    analysisQuality = status.quality;
+    if (!TELEMETRY_ENABLED) {
+      Serial.print("Quality ");
+      Serial.print(status.quality);
+      Serial.print(", Load ");
+      Serial.print(status.load * 100);
+      Serial.print("%, Max uS ");
+      Serial.print(status.maxComputeUs);
+      Serial.print(", Missed ");
+      Serial.println(status.missedBlocks);
+    }
+  }
+}
+
+// Print the latency histogram and the most recent traced frames (see latencyTrace.h).
+// host/latencyReplay reads these lines back out of a serial capture.
+void  reportLatency() {
+  uint32_t  frames = readLatencyHistogram(reportBins);
+  int       count  = readLatencyTrace(reportTrace, LATENCY_TRACE_FRAMES);
+
+  Serial.print("Latency Bins ");
+  Serial.print(frames);
+  Serial.print(" ");
+  Serial.print(LATENCY_BIN_US);
+  for (int b = 0; b < LATENCY_BINS; b++) {
+    Serial.print(" ");
+    Serial.print(reportBins[b]);
+  }
+  Serial.println();
+
+  for (int f = 0; f < count; f++) {
+    Serial.print("Latency Trace ");
+    Serial.print(reportTrace[f].blockUs);
+    Serial.print(" ");
+    Serial.print(reportTrace[f].analysedUs);
+    Serial.print(" ");
+    Serial.print(reportTrace[f].bandsUs);
+    Serial.print(" ");
+    Serial.print(reportTrace[f].renderUs);
+    Serial.print(" ");
+    Serial.println(reportTrace[f].shownUs);
+  }
+}
+
 // ==================================================================================================
 
+// Preset the adaptive noise floor with the fixed profile that used to be applied on every frame.
+// Start high on the low bands and drop down, never going below BASE_NOISE_FLOOR.
+void  initNoiseFloor (void){
+  uint32_t  noiseFloor = START_NOISE_FLOOR;
+
+  myFFT.setMinNoiseFloor(BASE_NOISE_FLOOR);
+
+  for (int b = 0; b < NUM_LO_BANDS; b++){
+    myFFT.presetNoiseFloor(0, LO_bandBins[b], LO_bandBins[b+1], noiseFloor);
+    if (noiseFloor > BASE_NOISE_FLOOR) {
+      noiseFloor = 97 * noiseFloor / 100;  // equiv 0.97 factor.
+    }
+  }
+
+  for (int b = 0; b < NUM_MD_BANDS; b++){
+    myFFT.presetNoiseFloor(1, MD_bandBins[b], MD_bandBins[b+1], noiseFloor);
+    if (noiseFloor > BASE_NOISE_FLOOR) {
+      noiseFloor = 97 * noiseFloor / 100;  // equiv 0.97 factor.
+    }
+  }
+
+  for (int b = 0; b < NUM_HI_BANDS; b++){
+    myFFT.presetNoiseFloor(2, HI_bandBins[b], HI_bandBins[b+1], noiseFloor);
+    if (noiseFloor > BASE_NOISE_FLOOR) {
+      noiseFloor = 95 * noiseFloor / 100;  // equiv 0.95 factor.
+    }
+  }
+}
+
 // Group Frequency Bins into Band Buckets based on the maximum nun number for each band
 // Each band covers more bind because bins are linear and bands are logorithmic.
+// Bins only count if they are above the noise threshold the analyser is tracking for them.
 void  fillBands (void){
-  uint32_t  noiseFloor;  
   uint8_t   band;   
 
   //  zero out all the LED band magnitudes.
   memset(bandValues, 0, sizeof(bandValues));
 
-  // Cycle through each of the LED bands.  Set initial noise threshold high and drop down.
-  noiseFloor = START_NOISE_FLOOR;
   band = 0;
   activeBands = 0;
     
   for (int b = 0; b < NUM_LO_BANDS; b++, band++){
     // Accumulate freq values from all bins that match this LED band,
-    bandValues[band] = (uint32_t)myFFT.read(0, LO_bandBins[b], LO_bandBins[b+1], noiseFloor);
+    bandValues[band] = (uint32_t)myFFT.readBand(0, LO_bandBins[b], LO_bandBins[b+1]);
+    addPitchCandidate(band, bandValues[band]);
     if (bandValues[band] > 2)
       activeBands++;
-
-    // Adjust Noise Floor
-    if (noiseFloor > BASE_NOISE_FLOOR) {
-      noiseFloor = 97 * noiseFloor / 100;  // equiv 0.97 factor.
-    }
   }
 
   for (int b = 0; b < NUM_MD_BANDS; b++, band++){
     // Accumulate freq values from all bins that match this LED band,
-    bandValues[band] = (uint32_t)myFFT.read(1, MD_bandBins[b], MD_bandBins[b+1], noiseFloor);
+    bandValues[band] = (uint32_t)myFFT.readBand(1, MD_bandBins[b], MD_bandBins[b+1]);
+    addPitchCandidate(band, bandValues[band]);
     if (bandValues[band] > 2)
       activeBands++;
-
-    // Adjust Noise Floor
-    if (noiseFloor > BASE_NOISE_FLOOR) {
-      noiseFloor = 97 * noiseFloor / 100;  // equiv 0.97 factor.
-    }
   }
 
   for (int b = 0; b < NUM_HI_BANDS; b++, band++){
     // Accumulate freq values from all bins that match this LED band,
-    bandValues[band] = (uint32_t)myFFT.read(2, HI_bandBins[b], HI_bandBins[b+1], noiseFloor);
+    bandValues[band] = (uint32_t)myFFT.readBand(2, HI_bandBins[b], HI_bandBins[b+1]);
+    addPitchCandidate(band, bandValues[band]);
     if (bandValues[band] > 2)
       activeBands++;
-
-    // Adjust Noise Floor
-    if (noiseFloor > BASE_NOISE_FLOOR) {
-      noiseFloor = 95 * noiseFloor / 100;  // equiv 0.95 factor.
-    }
   }
 
 }
@@ -51,6 +51,16 @@ byte arduinoFFT_float::Revision(void) {
 	return(FFT_LIB_REV);
 }
 
+// Change the transform size (a power of 2, no larger than the arrays given to the constructor).
+void arduinoFFT_float::setSamples(ushort samples) {
+	this->_samples = samples;
+	this->_power = Exponent(samples);
+}
+
+ushort arduinoFFT_float::Samples(void) {
+	return(this->_samples);
+}
+
 void arduinoFFT_float::RunFFT(void) {
     // Clear out imaginary values and run the FFT and then convert to magnitudes
     
@@ -60,17 +70,26 @@ void arduinoFFT_float::RunFFT(void) {
 }
 
 void arduinoFFT_float::Compute(byte dir)
+{
+	Compute(this->_vReal, this->_vImag, this->_samples, this->_power, dir);
+}
+
+void arduinoFFT_float::Compute(float *vReal, float *vImag, ushort samples, byte dir)
+{
+	Compute(vReal, vImag, samples, Exponent(samples), dir);
+}
+
+void arduinoFFT_float::Compute(float *vReal, float *vImag, ushort samples, byte power, byte dir)
 {// Computes in-place complex-to-complex FFT /
 
 	// Reverse bits /
 	unsigned short j = 0;
-	for (unsigned short i = 0; i < (this->_samples - 1); i++) {
+	for (unsigned short i = 0; i < (samples - 1); i++) {
 		if (i < j) {
-			Swap(&this->_vReal[i], &this->_vReal[j]);
-			if(dir==FFT_REVERSE)
-				Swap(&this->_vImag[i], &this->_vImag[j]);
+			Swap(&vReal[i], &vReal[j]);
+			Swap(&vImag[i], &vImag[j]);
 		}
-		unsigned short k = (this->_samples >> 1);
+		unsigned short k = (samples >> 1);
 		while (k <= j) {
 			j -= k;
 			k >>= 1;
@@ -78,26 +97,23 @@ void arduinoFFT_float::Compute(byte dir)
 		j += k;
 	}
 	// Compute the FFT  /
-#ifdef __AVR__
-	byte index = 0;
-#endif
 	float c1 = -1.0;
 	float c2 = 0.0;
 	unsigned short l2 = 1;
-	for (byte l = 0; (l < this->_power); l++) {
+	for (byte l = 0; (l < power); l++) {
 		unsigned short l1 = l2;
 		l2 <<= 1;
 		float u1 = 1.0;
 		float u2 = 0.0;
 		for (j = 0; j < l1; j++) {
-			 for (unsigned short i = j; i < this->_samples; i += l2) {
+			 for (unsigned short i = j; i < samples; i += l2) {
 					unsigned short i1 = i + l1;
-					float t1 = u1 * this->_vReal[i1] - u2 * this->_vImag[i1];
-					float t2 = u1 * this->_vImag[i1] + u2 * this->_vReal[i1];
-					this->_vReal[i1] = this->_vReal[i] - t1;
-					this->_vImag[i1] = this->_vImag[i] - t2;
-					this->_vReal[i] += t1;
-					this->_vImag[i] += t2;
+					float t1 = u1 * vReal[i1] - u2 * vImag[i1];
+					float t2 = u1 * vImag[i1] + u2 * vReal[i1];
+					vReal[i1] = vReal[i] - t1;
+					vImag[i1] = vImag[i] - t2;
+					vReal[i] += t1;
+					vImag[i] += t2;
 			 }
 			 float z = ((u1 * c1) - (u2 * c2));
 			 u2 = ((u1 * c2) + (u2 * c1));
@@ -111,20 +127,78 @@ void arduinoFFT_float::Compute(byte dir)
 	}
 	// Scaling for reverse transform /
 	if (dir != FFT_FORWARD) {
-		for (unsigned short i = 0; i < this->_samples; i++) {
-			 this->_vReal[i] /= this->_samples;
-			 this->_vImag[i] /= this->_samples;
+		for (unsigned short i = 0; i < samples; i++) {
+			 vReal[i] /= samples;
+			 vImag[i] /= samples;
 		}
 	}
 }
 
 void arduinoFFT_float::ComplexToMagnitude()
+{
+	ComplexToMagnitude(this->_vReal, this->_vImag, this->_samples);
+}
+
+void arduinoFFT_float::ComplexToMagnitude(float *vReal, float *vImag, ushort samples)
 { // vM is half the size of vReal and vImag
-	for (unsigned short i = 0; i < this->_samples; i++) {
-		this->_vReal[i] = sqrt(sq(this->_vReal[i]) + sq(this->_vImag[i]));
+	for (unsigned short i = 0; i < samples; i++) {
+		vReal[i] = sqrt(sq(vReal[i]) + sq(vImag[i]));
 	}
 }
 
+// Frequency of the largest peak in the magnitudes (after ComplexToMagnitude).
+float arduinoFFT_float::MajorPeak()
+{
+	float f = 0;
+	float v = 0;
+	MajorPeak(&f, &v);
+	return(f);
+}
+
+void arduinoFFT_float::MajorPeak(float *f, float *v)
+{
+	*f = 0;
+	*v = 0;
+	MajorPeak(1, (this->_samples >> 1) - 1, f, v);
+}
+
+// Find the largest local peak between binFirst and binLast, and refine it with a parabola through
+// the peak bin and its two neighbours.  f is the interpolated frequency, v the interpolated magnitude.
+// Returns false if there is no peak in the range.
+bool arduinoFFT_float::MajorPeak(ushort binFirst, ushort binLast, float *f, float *v)
+{
+	float maxY = 0;
+	ushort IndexOfMaxY = 0;
+
+	if (binFirst < 1) {
+		binFirst = 1;
+	}
+	if (binLast > (this->_samples >> 1) - 1) {
+		binLast = (this->_samples >> 1) - 1;
+	}
+
+	for (ushort i = binFirst; i <= binLast; i++) {
+		if ((this->_vReal[i-1] < this->_vReal[i]) && (this->_vReal[i] >= this->_vReal[i+1])) {
+			if (this->_vReal[i] > maxY) {
+				maxY = this->_vReal[i];
+				IndexOfMaxY = i;
+			}
+		}
+	}
+	if (IndexOfMaxY == 0) {
+		return(false);
+	}
+
+	float left   = this->_vReal[IndexOfMaxY-1];
+	float right  = this->_vReal[IndexOfMaxY+1];
+	float curve  = left - (2.0 * maxY) + right;
+	float delta  = (curve < 0) ? (0.5 * (left - right) / curve) : 0;
+
+	*f = ((IndexOfMaxY + delta) * this->_samplingFrequency) / this->_samples;
+	*v = maxY - (0.25 * (left - right) * delta);
+	return(true);
+}
+
 void arduinoFFT_float::Windowing(float *vData, uint16_t samples, uint8_t windowType, uint8_t dir)
 { // Weighing factors are computed once before multiple use of FFT
   float samplesMinusOne = (float(samples) - 1.0);
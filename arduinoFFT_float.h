@@ -60,6 +60,8 @@ public:
   
 	/* Functions */
   void RunFFT(void);
+  void setSamples(ushort samples);
+  ushort Samples(void);
 	byte Revision(void);
 	byte Exponent(ushort value);
 	void ComplexToMagnitude(float *vReal, float *vImag, ushort samples);
@@ -72,6 +74,7 @@ public:
 	void DCRemoval();
 	float MajorPeak();
 	void MajorPeak(float *f, float *v);
+	bool MajorPeak(ushort binFirst, ushort binLast, float *f, float *v);
 
 private:
 	/* Variables */
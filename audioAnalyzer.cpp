@@ -12,20 +12,41 @@
 #include <AudioStream.h>
 #include "audioAnalyzer.h"
 #include "bufferManager.h"
+#include "bandMapper.h"
 
 AudioAnalyzeFFT::AudioAnalyzeFFT(void) : AudioStream(1, inputQueueArray) 
 {
   LO_FFT = arduinoFFT_float(LO_vReal, LO_vImag,   LO_weights, LO_FFT_SAMPLES, LO_SAMPLING_FREQ, FFT_WIN_TYP_HAMMING);    
   LO_Buffer = BufferManager(LO_vReal, LO_weights, LO_short,   LO_FFT_SAMPLES, LO_SAMPLE_SKIP);
+  LO_Noise  = NoiseTracker(LO_vReal,  LO_smooth,  LO_threshold, LO_FREQ_BINS);
   
   MD_FFT = arduinoFFT_float(MD_vReal, MD_vImag,   MD_weights, MD_FFT_SAMPLES, MD_SAMPLING_FREQ, FFT_WIN_TYP_HAMMING);    
   MD_Buffer = BufferManager(MD_vReal, MD_weights, MD_short,   MD_FFT_SAMPLES, MD_SAMPLE_SKIP);
+  MD_Noise  = NoiseTracker(MD_vReal,  MD_smooth,  MD_threshold, MD_FREQ_BINS);
   
   HI_FFT = arduinoFFT_float(HI_vReal, HI_vImag,   HI_weights, HI_FFT_SAMPLES, HI_SAMPLING_FREQ, FFT_WIN_TYP_HAMMING);    
   HI_Buffer = BufferManager(HI_vReal, HI_weights, HI_short,   HI_FFT_SAMPLES, HI_SAMPLE_SKIP);
+  HI_Noise  = NoiseTracker(HI_vReal,  HI_smooth,  HI_threshold, HI_FREQ_BINS);
 
   state = 0;
   outputflag = false;
+  missedBlock = false;
+  missedSinceFrame = false;
+  oddFrame = false;
+  hiShift = 0;
+  silent = false;
+  silenceOpen  = SILENCE_OPEN_RMS;
+  silenceClose = SILENCE_CLOSE_RMS;
+  quietFrames  = 0;
+  overloadedFrames = 0;
+  headroomFrames = 0;
+  memset(&status, 0, sizeof(status));
+  memset(&stamp, 0, sizeof(stamp));
+  memset(&level, 0, sizeof(level));
+  levelMin   = 32767;
+  levelMax   = -32768;
+  levelSum   = 0;
+  levelSumSq = 0;
 
   memset(LO_short, 0, sizeof(LO_short));
   memset(MD_short, 0, sizeof(MD_short));
@@ -47,6 +68,78 @@ bool AudioAnalyzeFFT::missingBlocks(){
   return temp;
 }
 
+// Return the latency stamp of the latest output.
+FrameStamp AudioAnalyzeFFT::readStamp(){
+  FrameStamp temp;
+  __disable_irq();
+  temp = stamp;
+  __enable_irq();
+  return temp;
+}
+
+// Return the signal level of the latest output.
+AudioLevel AudioAnalyzeFFT::readLevel(){
+  AudioLevel temp;
+  __disable_irq();
+  temp = level;
+  __enable_irq();
+  return temp;
+}
+
+// Return the analysis timing and quality.
+AnalysisStatus AudioAnalyzeFFT::readStatus(){
+  AnalysisStatus temp;
+  __disable_irq();
+  temp = status;
+  __enable_irq();
+  return temp;
+}
+
+// True if the latest frame was below the silence gate.  Its bins all read as 0.
+bool AudioAnalyzeFFT::isSilent(){
+  return silent;
+}
+
+// Set the silence gate levels (RMS in raw sample units).  An openRms of 0 turns the gate off.
+void AudioAnalyzeFFT::setSilenceGate(float openRms, float closeRms){
+  __disable_irq();
+  silenceOpen  = openRms;
+  silenceClose = min(closeRms, openRms);
+  quietFrames  = 0;
+  silent       = false;
+  __enable_irq();
+}
+
+// Step the quality down when frames keep missing the deadline, and back up when there is headroom.
+void AudioAnalyzeFFT::adaptQuality(uint32_t computeUs) {
+  status.computeUs = computeUs;
+  status.load      = (float)computeUs / FRAME_BUDGET_US;
+  if (computeUs > status.maxComputeUs) {
+    status.maxComputeUs = computeUs;
+  }
+  status.framesAtLevel[status.quality]++;
+
+  if (missedSinceFrame || (computeUs > DEGRADE_US)) {
+    headroomFrames = 0;
+    if ((++overloadedFrames >= DEGRADE_FRAMES) && (status.quality < (QUALITY_LEVELS - 1))) {
+      status.quality++;
+      status.degradations++;
+      overloadedFrames = 0;
+    }
+  } else if (computeUs < RECOVER_US) {
+    overloadedFrames = 0;
+    if ((++headroomFrames >= RECOVER_FRAMES) && (status.quality > QUALITY_FULL)) {
+      status.quality--;
+      status.recoveries++;
+      headroomFrames = 0;
+    }
+  } else {
+    overloadedFrames = 0;
+    headroomFrames = 0;
+  }
+  missedSinceFrame = false;
+}
+
 // Return the current Scale ratio
 void  AudioAnalyzeFFT::setInputScale(float scale){
   inputScale = scale;
@@ -55,12 +148,16 @@ void  AudioAnalyzeFFT::setInputScale(float scale){
 float AudioAnalyzeFFT::read(int  range, unsigned short binNumber, float noiseThreshold) {
   float tempVal;
 
-  if ((range==0) && (binNumber < LO_FREQ_BINS)) {
+  if (silent) {
+    tempVal = 0;
+  } else if ((range==0) && (binNumber < LO_FREQ_BINS)) {
     tempVal = LO_vReal[binNumber];
   } else if ((range==1) && (binNumber < MD_FREQ_BINS)) {
     tempVal = MD_vReal[binNumber];
   } else if ((range==2) && (binNumber < HI_FREQ_BINS)) {
     tempVal = HI_vReal[binNumber];
+  } else if (range==ZOOM_RANGE) {
+    tempVal = Zoom.read(binNumber);
   } else {
     tempVal = 0;
   }
@@ -84,6 +181,109 @@ float AudioAnalyzeFFT::read(int  range, unsigned short binFirst, unsigned short
   return sum;
 }
 
+// Sum a band of bins, only counting those above their tracked noise threshold.
+float AudioAnalyzeFFT::readBand(int  range, unsigned short binFirst, unsigned short binLast) {
+  const float *mag;
+  const float *threshold;
+  unsigned short bins;
+
+  if (silent) {
+    return 0;
+  } else if (range == 0) {
+    mag = LO_vReal;  threshold = LO_threshold;  bins = LO_FREQ_BINS;
+  } else if (range == 1) {
+    mag = MD_vReal;  threshold = MD_threshold;  bins = MD_FREQ_BINS;
+  } else if (range == 2) {
+    mag = HI_vReal;  threshold = HI_threshold;  bins = HI_FREQ_BINS;
+  } else if (range == ZOOM_RANGE) {
+    return read(range, binFirst, binLast, 0.0);
+  } else {
+    return 0;
+  }
+
+  if (binLast >= bins) {
+    binLast = bins - 1;
+  }
+
+  // The half size HI FFT has bins twice as wide, with half the gain for a tone.
+  if ((range == 2) && hiShift) {
+    return sumShiftedBand(mag, threshold, binFirst, binLast, hiShift);
+  }
+
+  return sumBand(mag, threshold, binFirst, binLast);
+}
+
+// Find the strongest peak between two bins, to a fraction of a bin.  Returns false if there is none.
+bool  AudioAnalyzeFFT::readPeak(int range, unsigned short binFirst, unsigned short binLast, float &frequency, float &magnitude) {
+  if (silent) {
+    return false;
+  } else if (range == 0) {
+    return LO_FFT.MajorPeak(binFirst, binLast, &frequency, &magnitude);
+  } else if (range == 1) {
+    return MD_FFT.MajorPeak(binFirst, binLast, &frequency, &magnitude);
+  } else if (range == 2) {
+    return HI_FFT.MajorPeak(binFirst >> hiShift, binLast >> hiShift, &frequency, &magnitude);
+  }
+  return false;
+}
+
+// Set the starting noise threshold for a run of bins.
+void  AudioAnalyzeFFT::presetNoiseFloor(int range, unsigned short binFirst, unsigned short binLast, float level) {
+  if (range == 0) {
+    LO_Noise.preset(binFirst, binLast, level);
+  } else if (range == 1) {
+    MD_Noise.preset(binFirst, binLast, level);
+  } else if (range == 2) {
+    HI_Noise.preset(binFirst, binLast, level);
+  }
+}
+
+// Zoom in on a narrow band around centreHz, alongside the normal ranges.
+// The zoom bins are (44100 / decimation / ZOOM_FFT_SAMPLES) Hz wide.
+// The decimation filter is worked out with interrupts on, while the zoom is stopped.
+void  AudioAnalyzeFFT::setZoom(float centreHz, unsigned short decimation) {
+  __disable_irq();
+  Zoom.stop();
+  __enable_irq();
+
+  Zoom.setFilter(decimation);
+
+  __disable_irq();
+  Zoom.setZoom(centreHz, decimation);
+  __enable_irq();
+}
+
+void  AudioAnalyzeFFT::stopZoom(void) {
+  __disable_irq();
+  Zoom.stop();
+  __enable_irq();
+}
+
+// Return the centre frequency of a zoom bin.
+float AudioAnalyzeFFT::zoomFrequency(unsigned short binNumber) {
+  return Zoom.binFrequency(binNumber);
+}
+
+float AudioAnalyzeFFT::zoomBinWidth(void) {
+  return Zoom.binWidth();
+}
+
+// Zoom bins that are clear of aliases.  read() returns 0 for the others.
+unsigned short AudioAnalyzeFFT::zoomFirstBin(void) {
+  return Zoom.firstBin();
+}
+
+unsigned short AudioAnalyzeFFT::zoomLastBin(void) {
+  return Zoom.lastBin();
+}
+
+// Set the lowest noise threshold for all bins.
+void  AudioAnalyzeFFT::setMinNoiseFloor(float level) {
+  LO_Noise.setMinimum(level);
+  MD_Noise.setMinimum(level);
+  HI_Noise.setMinimum(level);
+}
+
 void AudioAnalyzeFFT::update(void)
 {
   audio_block_t *block;
@@ -94,18 +294,31 @@ void AudioAnalyzeFFT::update(void)
   block = receiveReadOnly();
   if (!block) {
     missedBlock = true;
+    missedSinceFrame = true;
+    status.missedBlocks++;
     return;
   }
+  blockUs = latencyNow();
 
   // Save a pointer to the latest audio block
   src = block->data;
 
-  // add the latest block to the hi and low buffers
+  // add the latest block to the hi and low buffers, and measure the signal level on the way.
+  bool zoomOn = Zoom.active();
   for (short sample = 0; sample < BURST_SAMPLES; sample++) {
-    LO_Buffer.addSample(*src);
-    MD_Buffer.addSample(*src);
-    HI_Buffer.addSample(*src);
-    src++;
+    int value = *src++;
+
+    LO_Buffer.addSample(value);
+    MD_Buffer.addSample(value);
+    HI_Buffer.addSample(value);
+    if (zoomOn) {
+      Zoom.addSample(value);
+    }
+
+    if (value < levelMin) levelMin = value;
+    if (value > levelMax) levelMax = value;
+    levelSum   += value;
+    levelSumSq += value * value;
   }
 
   // Release audio block back into the pool
@@ -115,15 +328,71 @@ void AudioAnalyzeFFT::update(void)
   // Do we have a full audio buffer?
   if (state == BURSTS_PER_FFT_UPDATE) {
 
-    // transfer the accumulated buffers to the FFT.  Remove bias and apply weights along the way
-    LO_Buffer.transfer(inputScale);
-    MD_Buffer.transfer(inputScale);
-    HI_Buffer.transfer(inputScale);
+    // publish the signal level of this frame, measured about its mean
+    const int   samples = BURST_SAMPLES * BURSTS_PER_FFT_UPDATE;
+    int         mean    = levelSum / samples;
+    float       power   = ((float)levelSumSq / samples) - ((float)mean * mean);
+
+    level.peakToPeak = levelMax - levelMin;
+    level.peak       = max(levelMax - mean, mean - levelMin);
+    level.rms        = (power > 0) ? sqrtf(power) : 0;
+    levelMin   = 32767;
+    levelMax   = -32768;
+    levelSum   = 0;
+    levelSumSq = 0;
+
+    // silence gate, with hysteresis.  Open straight away, close after a run of quiet frames.
+    if ((silenceOpen <= 0) || (level.rms >= silenceOpen)) {
+      quietFrames = 0;
+      silent = false;
+    } else if (level.rms < silenceClose) {
+      if (quietFrames < SILENCE_HOLD_FRAMES) {
+        quietFrames++;
+      } else if (!silent) {
+        silent = true;
+        status.gateCloses++;
+      }
+    }
+
+    // skip the transforms (and noise floor tracking) while the gate is closed.
+    if (silent) {
+      status.silentFrames++;
+    } else {
+      uint32_t startUs = micros();
+      QualityPlan plan = qualityPlan(status.quality, oddFrame);
+      oddFrame = !oddFrame;
+
+      // transfer the accumulated buffers to the FFT.  Remove bias and apply weights along the way
+      // Then process the FFT and follow the noise floor of every bin.
+      // A range that is skipped keeps its previous magnitudes.
+      if (plan.doLO) {
+        LO_Buffer.transfer(inputScale, plan.window, LO_FFT_SAMPLES);
+        LO_FFT.RunFFT();
+        LO_Noise.update();
+      }
+
+      if (plan.doMD) {
+        MD_Buffer.transfer(inputScale, plan.window, MD_FFT_SAMPLES);
+        MD_FFT.RunFFT();
+        MD_Noise.update();
+      }
+
+      HI_FFT.setSamples(plan.halfHI ? (HI_FFT_SAMPLES >> 1) : HI_FFT_SAMPLES);
+      HI_Buffer.transfer(inputScale, plan.window, HI_FFT.Samples());
+      HI_FFT.RunFFT();
+      if (!plan.halfHI) {
+        HI_Noise.update();
+      }
+      hiShift = plan.halfHI ? 1 : 0;
+
+      Zoom.run(inputScale);
+      adaptQuality(micros() - startUs);
+    }
 
-    // Process the FFT
-    LO_FFT.RunFFT();
-    MD_FFT.RunFFT();
-    HI_FFT.RunFFT();
+    // stamp the output with the arrival time of the newest block in it.
+    stamp.blockUs    = blockUs;
+    stamp.analysedUs = latencyNow();
+    stamp.valid      = true;
 
     outputflag = true;
     state = 0;
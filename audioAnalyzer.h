@@ -28,6 +28,10 @@
 #include "arm_math.h"
 #include "arduinoFFT_float.h"
 #include "bufferManager.h"
+#include "latencyTrace.h"
+#include "noiseTracker.h"
+#include "qualityPlan.h"
+#include "zoomAnalyzer.h"
 
 //  =================  Multi-Task Shared Data =================
 // -- Audio Constants
@@ -54,12 +58,52 @@ const unsigned short HI_SAMPLING_FREQ     = 44100 / HI_SAMPLE_SKIP; // Frequency
 const unsigned short HI_FFT_SAMPLES       =  1024;        // Number of samples used to do FFT. 
 const unsigned short HI_FREQ_BINS         =  HI_FFT_SAMPLES >> 1; // Number of results
 
+// Zoom Range.  read() and readBand() on this range return zoom FFT bins (see zoomAnalyzer.h)
+#define ZOOM_RANGE          3
+
 // Audio Sample constants
 const unsigned short BURST_SAMPLES     =   128;         // Number of audio samples taken in one "Burst"
 const unsigned short BURSTS_PER_FFT_UPDATE = 4;         // Number of Burst received before doing an FFT update
 const unsigned short NUM_BURSTS        = 8;
 const unsigned short SIZEOF_BURST      = (BURST_SAMPLES << 2);      // Number of bytes in a Burst Buffer
 
+// Analysis deadline.  Every frame must be analysed within FRAME_BUDGET_US, but the whole analysis
+// runs inside one update() call, which has to finish before the next block arrives.
+const unsigned long FRAME_BUDGET_US    = (BURST_SAMPLES * BURSTS_PER_FFT_UPDATE * 1000000UL) / 44100;  // 11.6 mSec
+const unsigned long BLOCK_BUDGET_US    = FRAME_BUDGET_US / BURSTS_PER_FFT_UPDATE;                     //  2.9 mSec
+const unsigned long DEGRADE_US         = (BLOCK_BUDGET_US * 9) / 10;    // Frames slower than this are overloaded
+const unsigned long RECOVER_US         = (BLOCK_BUDGET_US * 4) / 10;    // Frames faster than this have headroom
+const unsigned short DEGRADE_FRAMES    =  3;          // Overloaded frames in a row before dropping a quality step
+const unsigned short RECOVER_FRAMES    = 86;          // Frames with headroom in a row before raising a quality step
+
+// Silence gate.  Frames quieter than this (RMS in raw sample units, before the input scale) are not
+// transformed, and are published as silent.  The gate closes after SILENCE_HOLD_FRAMES quiet frames,
+// and opens again on the first frame above SILENCE_OPEN_RMS.
+#define SILENCE_OPEN_RMS      10.0                // Open the gate at or above this level
+#define SILENCE_CLOSE_RMS      6.0                // Close the gate below this level
+#define SILENCE_HOLD_FRAMES     43                // Quiet frames before closing (0.5 Sec)
+
+// Analysis timing and quality, for readStatus().
+struct AnalysisStatus {
+  uint8_t   quality;                          // Current QUALITY_ step
+  uint32_t  computeUs;                        // Analysis time of the latest frame
+  uint32_t  maxComputeUs;                     // Longest analysis time so far
+  float     load;                             // Latest analysis time as a fraction of FRAME_BUDGET_US
+  uint32_t  missedBlocks;                     // Updates with no audio block
+  uint32_t  degradations;                     // Quality steps down
+  uint32_t  recoveries;                       // Quality steps up
+  uint32_t  framesAtLevel[QUALITY_LEVELS];    // Frames analysed at each quality step
+  uint32_t  silentFrames;                     // Frames skipped by the silence gate (11.6 mSec each)
+  uint32_t  gateCloses;                       // Times the silence gate has closed
+};
+
+// Signal level of one analysis frame, measured as the samples come in.
+struct AudioLevel {
+  uint16_t  peak;                 // Largest sample distance from the DC bias
+  uint16_t  peakToPeak;           // Largest sample minus smallest sample
+  float     rms;                  // RMS about the DC bias (Leq over the frame)
+};
+
 // ---------------------------------------------
 
 class AudioAnalyzeFFT : public AudioStream
@@ -71,7 +115,22 @@ public:
   float read(int range, unsigned short binNumber);
   float read(int range, unsigned short binNumber, float noiseThreshold);
   float read(int range, unsigned short binFirst, unsigned short binLast, float noiseThreshold);
+  float readBand(int range, unsigned short binFirst, unsigned short binLast);
+  bool  readPeak(int range, unsigned short binFirst, unsigned short binLast, float &frequency, float &magnitude);
+  void  presetNoiseFloor(int range, unsigned short binFirst, unsigned short binLast, float level);
+  void  setMinNoiseFloor(float level);
   void  setInputScale(float scale);
+  void  setZoom(float centreHz, unsigned short decimation);
+  void  stopZoom(void);
+  float zoomFrequency(unsigned short binNumber);
+  float zoomBinWidth(void);
+  unsigned short zoomFirstBin(void);
+  unsigned short zoomLastBin(void);
+  FrameStamp readStamp(void);
+  AudioLevel readLevel(void);
+  AnalysisStatus readStatus(void);
+  bool  isSilent(void);
+  void  setSilenceGate(float openRms, float closeRms);
   virtual void update(void);
 
   ushort output[512] __attribute__ ((aligned (4)));
@@ -79,6 +138,7 @@ public:
 private:
   void init(void);
   void copy_to_fft_buffer(void *destination, const void *source);
+  void adaptQuality(uint32_t computeUs);
   
   //audio_block_t *blocklist[BURSTS_PER_AUDIO];
   short buffer[2048] __attribute__ ((aligned (4)));
@@ -86,6 +146,26 @@ private:
   volatile bool outputflag;
   volatile bool missedBlock;
   unsigned short state;
+  uint32_t   blockUs;
+  FrameStamp stamp;
+
+  int       levelMin;
+  int       levelMax;
+  int32_t   levelSum;
+  int64_t   levelSumSq;
+  AudioLevel level;
+
+  AnalysisStatus status;
+  unsigned short overloadedFrames;
+  unsigned short headroomFrames;
+  bool      missedSinceFrame;
+  bool      oddFrame;
+  uint8_t   hiShift;                  // HI bins are (bin >> hiShift) while running the half size FFT
+
+  volatile bool silent;               // The latest frame was gated
+  float     silenceOpen;
+  float     silenceClose;
+  unsigned short quietFrames;
   
   audio_block_t *inputQueueArray[1];
 
@@ -94,24 +174,38 @@ private:
   float     LO_vImag[LO_FFT_SAMPLES];
   float     LO_weights[LO_FFT_SAMPLES];
 
+  float     LO_smooth[LO_FREQ_BINS];
+  float     LO_threshold[LO_FREQ_BINS];
+
   arduinoFFT_float LO_FFT;
   BufferManager    LO_Buffer;
+  NoiseTracker     LO_Noise;
 
   short     MD_short[MD_FFT_SAMPLES];
   float     MD_vReal[MD_FFT_SAMPLES];
   float     MD_vImag[MD_FFT_SAMPLES];
   float     MD_weights[MD_FFT_SAMPLES];
 
+  float     MD_smooth[MD_FREQ_BINS];
+  float     MD_threshold[MD_FREQ_BINS];
+
   arduinoFFT_float MD_FFT;
   BufferManager    MD_Buffer;
+  NoiseTracker     MD_Noise;
 
   short     HI_short[LO_FFT_SAMPLES];
   float     HI_vReal[HI_FFT_SAMPLES];
   float     HI_vImag[HI_FFT_SAMPLES];
   float     HI_weights[HI_FFT_SAMPLES];
   
+  float     HI_smooth[HI_FREQ_BINS];
+  float     HI_threshold[HI_FREQ_BINS];
+
   arduinoFFT_float HI_FFT;
   BufferManager    HI_Buffer;
+  NoiseTracker     HI_Noise;
+
+  ZoomAnalyzer     Zoom;
 
 };
 
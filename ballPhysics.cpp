@@ -0,0 +1,127 @@
+/*
+  Ball Physics.
+  See ballPhysics.h
+*/
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "ballPhysics.h"
+
+// ======================================================================================================
+
+// Ball data is kept as separate arrays so the physics loop streams through them.
+float     ballPos[MAX_BALLS];
+float     ballVel[MAX_BALLS];
+uint8_t   ballBand[MAX_BALLS];
+int       nextBall = 0;
+
+uint16_t  numBalls[NUM_BANDS];
+uint32_t  lastLaunchMs[NUM_BANDS];
+uint16_t  maxBandBalls = MAX_BAND_BALLS;
+uint32_t  bandLaunchMs = BAND_LAUNCH_MS;
+
+uint32_t  lastMoveMs = 0;
+uint32_t  physicsMs  = 0;               // Time not yet simulated
+
+// ======================================================================================================
+
+void  initBalls() {
+  memset(ballPos, 0, sizeof(ballPos));
+  memset(ballVel, 0, sizeof(ballVel));
+  memset(ballBand, 0, sizeof(ballBand));
+  memset(numBalls, 0, sizeof(numBalls));
+  memset(lastLaunchMs, 0, sizeof(lastLaunchMs));
+  nextBall   = 0;
+  physicsMs  = 0;
+  lastMoveMs = millis();
+}
+
+// Change the per band launch limits from the MAX_BAND_BALLS and BAND_LAUNCH_MS defaults.
+void  setBallLimits(uint16_t maxBand, uint32_t launchMs) {
+  maxBandBalls = maxBand;
+  bandLaunchMs = launchMs;
+}
+
+void  addBall(float avel, int  aband) {
+    uint32_t tnow = millis();
+
+    // add new ball to end of list if there is room, and this band is allowed another one.
+    if ((nextBall < MAX_BALLS) &&
+        (numBalls[aband] < maxBandBalls) &&
+        ((tnow - lastLaunchMs[aband]) >= bandLaunchMs)) {
+      ballPos[nextBall]  = 0;
+      ballVel[nextBall]  = avel;
+      ballBand[nextBall] = aband;
+
+      numBalls[aband]++;
+      lastLaunchMs[aband] = tnow;
+      nextBall++;
+    }
+}
+
+// Advance the balls by whole physics steps.  Left over time is carried in the accumulator.
+void  moveBalls() {
+    uint32_t tnow  = millis();
+    int      steps;
+
+    physicsMs += (tnow - lastMoveMs);
+    lastMoveMs = tnow;
+
+    steps      = physicsMs / BALL_STEP_MS;
+    physicsMs -= steps * BALL_STEP_MS;
+    if (steps > MAX_BALL_STEPS) {
+      steps = MAX_BALL_STEPS;
+    }
+    if (steps > 0) {
+      stepBalls(steps);
+    }
+}
+
+// Gravity is the only force, so N fixed steps collapse into one exact update of N * step.
+void  stepBalls(int steps) {
+    float elapsed       = steps * BALL_STEP_MS * 0.001f;
+    float deltaV        = (float)GRAVITY * elapsed;
+    float halfATSquared = deltaV * elapsed * 0.5f;
+
+    // process each ball.  A landed ball is replaced by the last one, which is then processed in its place.
+    int ball = 0;
+    while (ball < nextBall) {
+      ballPos[ball] += (halfATSquared + (ballVel[ball] * elapsed));
+      ballVel[ball] += deltaV;
+
+      // has the ball hit the ground?
+      if (ballPos[ball] <= 0) {
+        nextBall--;
+        numBalls[ballBand[ball]]--;
+
+        ballPos[ball]  = ballPos[nextBall];
+        ballVel[ball]  = ballVel[nextBall];
+        ballBand[ball] = ballBand[nextBall];
+      } else {
+        ball++;
+      }
+    }
+}
+
+// Light the pixel under each ball in the colour of the band that launched it.
+void  drawBalls(CRGB *frame, int length, const CRGB *bandColors) {
+    int led;
+
+    for (int ball = 0; ball < nextBall; ball++) {
+      led = (int)(ballPos[ball] * LED_PER_METER);
+      if (led < length) {
+        frame[led] = bandColors[ballBand[ball]];
+      }
+    }
+}
+
+// Hand each ball to plot() at its position in logical pixels, with the fraction kept.
+void  drawBalls(BallPlot plot, const CRGB *bandColors) {
+    for (int ball = 0; ball < nextBall; ball++) {
+      plot(ballPos[ball] * LED_PER_METER, bandColors[ballBand[ball]]);
+    }
+}
+
+int   ballCount() {
+  return (nextBall);
+}
@@ -0,0 +1,48 @@
+/*
+  Ball Physics.
+
+  The particle engine behind the Fireworks (ball) display.  Balls are kept as separate arrays
+  (position, velocity, band) so the update loop streams through them, and a landed ball is replaced
+  by the last one in the list.  Time is simulated in whole steps of BALL_STEP_MS, with the time left
+  over carried to the next frame.  Each band can be limited in how many balls it has in the air and
+  how often it launches one.
+
+  Balls can be drawn into the logical frame (one pixel per band, see ledLayout.h), or handed to a
+  plot function by position.  The Fireworks display plots them with setLEDSpot(), so a long strip
+  shows every ball on its own LED, at the strip's full resolution.
+
+  Only needs millis() and a CRGB, so it also builds on the host (see host/ballBench.cpp).
+*/
+
+#ifndef ballPhysics_h /* Prevent loading library twice */
+#define ballPhysics_h
+
+#include <Arduino.h>
+#include "devconf.h"
+
+#define  FASTLED_INTERNAL
+#include "FastLED.h"
+
+#define MAX_BALLS         2048                  // maximum number of balls in the air
+#define MAX_BAND_BALLS      16                  // maximum number of balls in the air from one band
+#define BAND_LAUNCH_MS      30                  // minimum time between launches from one band
+#define BALL_STEP_MS         2                  // physics time step
+#define MAX_BALL_STEPS      50                  // limit on catch up steps after a stall
+
+typedef void (*BallPlot)(float position, const CRGB &color);    // draws one ball at a logical position
+
+//#define GRAVITY          -2.0                //  
+#define GRAVITY            -1.9                //  was 1.5
+
+#define LED_PER_METER       60
+
+void  initBalls();
+void  setBallLimits(uint16_t maxBandBalls, uint32_t bandLaunchMs);
+void  addBall(float vel, int band);
+void  moveBalls();
+void  stepBalls(int steps);
+void  drawBalls(CRGB *frame, int length, const CRGB *bandColors);
+void  drawBalls(BallPlot plot, const CRGB *bandColors);
+int   ballCount();
+
+#endif
@@ -0,0 +1,103 @@
+/*
+  Band Envelope.
+  See bandEnvelope.h
+*/
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "renderScheduler.h"
+#include "bandEnvelope.h"
+
+#define FRAME_MS    (ANALYSIS_INTERVAL_US / 1000.0)
+
+// ======================================================================================================
+
+float     envelope[NUM_BANDS];          // Smoothed band value
+float     attackCoef[NUM_BANDS];        // Fraction of a rise applied each frame
+float     releaseCoef[NUM_BANDS];       // Fraction of a fall applied each frame
+
+float     peak[NUM_BANDS];              // Held peak
+float     peakDecay[NUM_BANDS];         // Peak multiplier per frame once the hold is over
+uint16_t  holdFrames[NUM_BANDS];        // Frames to hold a new peak, 0 for no peak hold
+uint16_t  holdCount[NUM_BANDS];         // Frames of hold left
+bool      peakHold = false;             // Any band with a peak hold
+
+// ======================================================================================================
+
+// Per frame coefficient of a one pole filter with a time constant of timeMs
+float frameCoef(float timeMs) {
+  return (timeMs > 0) ? (1.0 - expf(-FRAME_MS / timeMs)) : 1.0;
+}
+
+void  initEnvelope() {
+  setEnvelope(0, NUM_LO_BANDS - 1, ENVELOPE_ATTACK_MS, ENVELOPE_LO_RELEASE_MS);
+  setEnvelope(NUM_LO_BANDS, NUM_LO_BANDS + NUM_MD_BANDS - 1, ENVELOPE_ATTACK_MS, ENVELOPE_MD_RELEASE_MS);
+  setEnvelope(NUM_LO_BANDS + NUM_MD_BANDS, NUM_BANDS - 1, ENVELOPE_ATTACK_MS, ENVELOPE_HI_RELEASE_MS);
+  setPeakHold(0, NUM_BANDS - 1, ENVELOPE_HOLD_MS, ENVELOPE_HOLD_DECAY_MS);
+  resetEnvelope();
+}
+
+void  resetEnvelope() {
+  memset(envelope,  0, sizeof(envelope));
+  memset(peak,      0, sizeof(peak));
+  memset(holdCount, 0, sizeof(holdCount));
+}
+
+// Set the attack and release time constants of a run of bands.  0 mSec follows the band instantly.
+void  setEnvelope(int firstBand, int lastBand, float attackMs, float releaseMs) {
+  float attack  = frameCoef(attackMs);
+  float release = frameCoef(releaseMs);
+
+  for (int b = max(firstBand, 0); (b <= lastBand) && (b < NUM_BANDS); b++) {
+    attackCoef[b]  = attack;
+    releaseCoef[b] = release;
+  }
+}
+
+// Hold each new peak for holdMs, then let it fall with a time constant of decayMs.  0 mSec hold turns it off.
+void  setPeakHold(int firstBand, int lastBand, float holdMs, float decayMs) {
+  uint16_t  frames = (uint16_t)(holdMs / FRAME_MS + 0.5);
+  float     decay  = 1.0 - frameCoef(decayMs);
+
+  for (int b = max(firstBand, 0); (b <= lastBand) && (b < NUM_BANDS); b++) {
+    holdFrames[b] = frames;
+    peakDecay[b]  = decay;
+  }
+
+  peakHold = false;
+  for (int b = 0; b < NUM_BANDS; b++) {
+    peakHold = peakHold || (holdFrames[b] > 0);
+  }
+}
+
+// Run one analysis frame through the envelopes.  Returns false once every envelope has decayed to 0.
+bool  runEnvelope(const uint32_t * bandValues, uint32_t * envelopeValues) {
+  uint32_t  lit = 0;
+
+  for (int b = 0; b < NUM_BANDS; b++) {
+    float live = (float)bandValues[b];
+    float coef = (live > envelope[b]) ? attackCoef[b] : releaseCoef[b];
+    envelope[b] += (live - envelope[b]) * coef;
+  }
+
+  if (peakHold) {
+    for (int b = 0; b < NUM_BANDS; b++) {
+      if (envelope[b] >= peak[b]) {
+        peak[b]      = envelope[b];
+        holdCount[b] = holdFrames[b];
+      } else if (holdCount[b] > 0) {
+        holdCount[b]--;
+      } else {
+        peak[b] = max(peak[b] * peakDecay[b], envelope[b]);
+      }
+      envelopeValues[b] = (uint32_t)(holdFrames[b] ? peak[b] : envelope[b]);
+      lit |= envelopeValues[b];
+    }
+  } else {
+    for (int b = 0; b < NUM_BANDS; b++) {
+      envelopeValues[b] = (uint32_t)envelope[b];
+      lit |= envelopeValues[b];
+    }
+  }
+  return (lit != 0);
+}
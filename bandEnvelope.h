@@ -0,0 +1,26 @@
+/*
+  Band Envelope.
+
+  Attack/release smoothing of every band, between fillBands() and the renderers, so the visual
+  persistence of each band can be set independently of its FFT window length.
+
+  Each band has its own attack and release time constant, and an optional peak hold: the band is
+  held at its latest peak for a hold time, then released with its own decay.  The state and the
+  coefficients are kept as arrays (one entry per band) and updated in one pass over all bands.
+
+  A time of 0 means no smoothing, so with the defaults in devconf.h the bands pass straight through.
+*/
+
+#ifndef bandEnvelope_h /* Prevent loading library twice */
+#define bandEnvelope_h
+
+#include <Arduino.h>
+#include "devconf.h"
+
+void  initEnvelope();
+void  resetEnvelope();
+void  setEnvelope(int firstBand, int lastBand, float attackMs, float releaseMs);
+void  setPeakHold(int firstBand, int lastBand, float holdMs, float decayMs);
+bool  runEnvelope(const uint32_t * bandValues, uint32_t * envelopeValues);
+
+#endif
@@ -0,0 +1,53 @@
+/*
+  Band Mapper.
+
+  Sums runs of FFT bins into bands, only counting bins above their noise threshold.
+
+  Shared by the analyser (audioAnalyzer.cpp) and the host side tools (host/), so this file must
+  only depend on the standard C headers.
+*/
+
+#ifndef bandMapper_h /* Prevent loading library twice */
+#define bandMapper_h
+
+#include <stdint.h>
+
+// Sum the bins from binFirst to binLast (inclusive) that are at or above their threshold.
+static inline float sumBand(const float *mag, const float *threshold, unsigned short binFirst, unsigned short binLast) {
+  float sum = 0.0;
+
+  for (unsigned short bin = binFirst; bin <= binLast; bin++) {
+    sum += (mag[bin] < threshold[bin]) ? 0 : mag[bin];
+  }
+  return sum;
+}
+
+// As sumBand(), for bins of a smaller FFT:  each of its bins is (1 << shift) of these bins wide,
+// with 1 / (1 << shift) of the gain for a tone.  Each wide bin the band touches is counted once,
+// against the threshold of the first full size bin it covers.
+static inline float sumShiftedBand(const float *mag, const float *threshold, unsigned short binFirst, unsigned short binLast, uint8_t shift) {
+  float gain = (float)(1 << shift);
+  float sum  = 0.0;
+
+  for (unsigned short bin = binFirst >> shift; bin <= (binLast >> shift); bin++) {
+    float value = mag[bin] * gain;
+    sum += (value < threshold[bin << shift]) ? 0 : value;
+  }
+  return sum;
+}
+
+// Fill bandValues[bands] from one range.  Band b covers bins bandBins[b] to bandBins[b+1].
+static inline void mapBands(const float *mag, const float *threshold, const uint16_t *bandBins, int bands, uint32_t *bandValues) {
+  for (int b = 0; b < bands; b++) {
+    bandValues[b] = (uint32_t)sumBand(mag, threshold, bandBins[b], bandBins[b + 1]);
+  }
+}
+
+// As mapBands(), from a smaller FFT (see sumShiftedBand()).
+static inline void mapShiftedBands(const float *mag, const float *threshold, const uint16_t *bandBins, int bands, uint8_t shift, uint32_t *bandValues) {
+  for (int b = 0; b < bands; b++) {
+    bandValues[b] = (uint32_t)sumShiftedBand(mag, threshold, bandBins[b], bandBins[b + 1], shift);
+  }
+}
+
+#endif
@@ -17,6 +17,7 @@ BufferManager::BufferManager(float *vReal, float *weight, short *vShort, unsigne
 	this->_packingNum 	= packingNum;
 	this->_nextSample 	= 0;
 	this->_sampleSum   	= 0;
+	this->_windowGain   = 0;
 	this->_DCBias     	= 0;
   this->_packCount    = 0;
   this->_packedValue  = 0;
@@ -62,14 +63,42 @@ void	BufferManager::addSample(short value) {
 
 // Transfer from the circular buffer.  Remove the DC Bias and apply weight
 void	BufferManager::transfer(float inputScale){
-  unsigned short  fromIndex = _nextSample;
+  transfer(inputScale, true, _samples);
+}
+
+// Transfer just the newest samples from the circular buffer, with or without the window weights.
+// Without them, samples are scaled by the average weight instead, so band levels stay the same.
+// A shorter transfer takes every (samples / count)th weight, so it still gets the whole window.
+void	BufferManager::transfer(float inputScale, bool window, unsigned short samples){
+  unsigned short  fromIndex;
   unsigned short  toIndex   = 0;
+  unsigned short  weightStep;
   float           audioVal;
+
+  if ((samples == 0) || (samples > _samples)) {
+    samples = _samples;
+  }
+  fromIndex  = (_nextSample + _samples - samples) % _samples;
+  weightStep = _samples / samples;
   
   _DCBias =  _sampleSum / _samples;
 
-  while (toIndex < _samples) {
-    audioVal = ((float)(_vShort[fromIndex++] - _DCBias) * _weight[toIndex]) * inputScale;
+  if (!window) {
+    if (_windowGain == 0) {
+      for (unsigned short i = 0; i < _samples; i++) {
+        _windowGain += _weight[i];
+      }
+      _windowGain /= _samples;
+    }
+    inputScale *= _windowGain;
+  }
+
+  while (toIndex < samples) {
+    if (window) {
+      audioVal = ((float)(_vShort[fromIndex++] - _DCBias) * _weight[toIndex * weightStep]) * inputScale;
+    } else {
+      audioVal = (float)(_vShort[fromIndex++] - _DCBias) * inputScale;
+    }
     _vReal[toIndex++] = audioVal;
 
     if (fromIndex >= _samples) {
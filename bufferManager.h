@@ -14,6 +14,7 @@ public:
   BufferManager(float *vReal, float *weight, short *vShort, unsigned short samples, unsigned short packingNum);
 	void	addSample(short value);
 	void	transfer(float inputScale);
+	void	transfer(float inputScale, bool window, unsigned short samples);  // samples should divide the buffer size
 
 private:
 	float   *_vReal;
@@ -27,6 +28,7 @@ private:
   int   _packedSum;
   int   _packedValue;
   long  _sampleSum;
+  float _windowGain;
   int  _doDebug;
 };
 
@@ -9,6 +9,11 @@
 #define NUM_HI_BANDS        48                    // Number of HIGH frequency bands
 #define NUM_BANDS           (NUM_LO_BANDS + NUM_MD_BANDS + NUM_HI_BANDS)    // Total Number of frequency bands being displayed (104)
 
+// First FFT bin of each band (and one past the last band).  Each band sums its first bin to the next band's first bin.
+#define LO_BAND_BINS        {13,14,15,16,17,18,20,21,22,23,25,26,28,29,31,33,35,37,39,41,44,46,49,52,55,58}
+#define MD_BAND_BINS        {29,31,33,35,37,39,41,44,46,49,52,55,58,62,66,70,74,78,83,88,93,98,104,110,117,124,131,139,147,156,165,175}
+#define HI_BAND_BINS        {25,27,28,30,32,33,35,37,40,42,45,47,50,53,56,60,63,67,71,75,79,84,89,94,100,106,112,119,126,134,142,150,159,168,178,189,200,212,225,238,252,267,283,300,318,337,357,378,400}
+
 #define NUM_LEDS            NUM_BANDS             // One LED per Band
 #define MIN_DB              30.0
 #define ORANGE_DB           70.0
@@ -17,12 +22,38 @@
 #define DB_RANGE           (MAX_DB - MIN_DB)
 #define DB_PER_LED         (DB_RANGE / NUM_LEDS)
 
+// Band envelopes (see bandEnvelope.h).  Time constants in mSec, 0 passes the bands straight through.
+// For reference, the FFT windows are about 370 mSec (LO), 185 mSec (MD) and 23 mSec (HI) long.
+#define ENVELOPE_ATTACK_MS       0
+#define ENVELOPE_LO_RELEASE_MS   0
+#define ENVELOPE_MD_RELEASE_MS   0
+#define ENVELOPE_HI_RELEASE_MS   0
+#define ENVELOPE_HOLD_MS         0                // Peak hold time, 0 for no peak hold
+#define ENVELOPE_HOLD_DECAY_MS 100                // Peak release once the hold is over
+
+#define ZOOM_CENTRE_HZ       0                    // Zoom FFT centre (eg: 60 for mains hum), 0 for no zoom range
+#define ZOOM_DECIMATION_NUM 256                    // Zoom FFT bins are 44100 / ZOOM_DECIMATION_NUM / 256 Hz wide
+
+#define TELEMETRY_ENABLED   false                 // Stream binary band frames out of Serial (see telemetryFormat.h)
+
 #define LED_DATA_PIN        12
 #define LED_CLOCK_PIN       14
 
+// LED output channels.  Each one is a separate APA102 strip:  { data pin, clock pin, number of LEDs }
+#define NUM_LED_CHANNELS     1
+#define MAX_CHANNEL_LEDS   300                    // Longest strip on any channel (5 Meters)
+#define LED_CHANNELS        { { LED_DATA_PIN, LED_CLOCK_PIN, NUM_LEDS } }
+
+// LED segments.  Each one spreads a run of bands over a run of LEDs on one channel:
+//    { channel, first LED, number of LEDs, first band, last band, mirror }
+#define NUM_LED_SEGMENTS     1
+#define LED_SEGMENTS        { { 0, 0, NUM_LEDS, 0, NUM_BANDS - 1, FLIP_LED_ORDER } }
+
 // NV RAM locations
-#define MODE_ADDRESS         1
+#define MODE_ADDRESS         1                    // Original fixed locations.  Only read if there are no settings records.
 #define GAIN_ADDRESS         2
+#define SETTINGS_ADDRESS    16                    // Start of the wear levelled settings records
+#define SETTINGS_SLOTS      64                    // Number of settings records to rotate through
 
 #define MIN_GAIN_NUM         0
 #define MAX_GAIN_NUM        (NUM_LEDS - 1)
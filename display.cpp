@@ -7,24 +7,16 @@
 #include "arm_math.h"
 #include "devconf.h"
 #include "display.h"
-
-#define  FASTLED_INTERNAL
-#include "FastLED.h"
+#include "ledOutput.h"
+#include "onsetDetector.h"
+#include "pitchTracker.h"
 
 // ======================================================================================================
 
-CRGB      leds[NUM_LEDS];
-
 float     hueStep;
+CRGB      bandColor[NUM_BANDS];         // Full brightness colour of each band
+uint8_t   brightnessLUT[MAX_LED_BRIGHTNESS + 1];  // Intensity to colour scale factor
 int       numBands;
-int       nextBall = 0;
-uint32_t  lastMoveMs = 0;
-
-float     pos[MAX_BALLS];
-float     vel[MAX_BALLS];
-uint8_t   band[MAX_BALLS];
-
-uint8_t   numBalls[NUM_BANDS];
 short     displayMode; 
 uint32_t  modeChangeRelease = 0;
 
@@ -36,8 +28,9 @@ double    highTrip  = 1;
 int       orangeLED;
 int       redLED;
 
-double  peakFilter = 0;
-double  levelFilter = 0;
+float   peakFilter = 0;
+float   levelFilter = 0;
+float   dbLUT[1 << VU_LOG_BITS];        // dB of each peak to peak mantissa, in the lowest octave
 
 // ======================================================================================================
 // Generic Display Functions
@@ -60,8 +53,8 @@ short  switchDisplayMode() {
 void  initDisplay(){
 
   delay(250);      // sanity check delay
-  FastLED.addLeds<APA102, BGR>(leds, NUM_LEDS);
-  FastLED.clear();
+  clearLEDs();
+  initBandPalette(NUM_BANDS);
   
   switch (displayMode) {
     default:
@@ -69,8 +62,7 @@ void  initDisplay(){
       break;
 
     case 1:
-      orangeLED   = (int)((ORANGE_DB - MIN_DB) / DB_PER_LED);
-      redLED      = (int)((RED_DB    - MIN_DB) / DB_PER_LED);
+      initVuDisplay();
       break;
       
     case 2:
@@ -110,6 +102,11 @@ void  updateDisplay(uint32_t * bandValues) {
   }
 }
 
+// True when the display has nothing left to animate on its own (eg: no balls in the air).
+bool  displayIdle() {
+  return (displayMode != 4) || (ballCount() == 0);
+}
+
 // ======================================================================================================
 // trajectory functions
 // ======================================================================================================
@@ -118,30 +115,55 @@ void  updateDisplay(uint32_t * bandValues) {
 //  Basic display functions
 // ======================================================================================================
 void  setLEDBand(int band,  int intensity) {
-  setLED(band, (uint16_t)(band * hueStep), intensity);
-}
-
-int flipLEDs(int num) {
-  return (NUM_LEDS - num - 1);
+  if (band < NUM_BANDS) {
+    scaleColor(leds[band], bandColor[band], brightnessLUT[intensity]);
+  }
 }
 
 void  setLED(int pos, int hue, int intensity) {
   if (pos < NUM_LEDS) {
-    if (FLIP_LED_ORDER){
-      pos = flipLEDs(pos);
-    } 
-  
     leds[pos].setHSV(hue, 255, intensity);
   }
 }
 
+// Scale a full brightness colour by a brightnessLUT[] factor (255 = unchanged).
+void  scaleColor(CRGB &led, const CRGB &color, uint16_t scale) {
+  scale++;
+  led.r = (color.r * scale) >> 8;
+  led.g = (color.g * scale) >> 8;
+  led.b = (color.b * scale) >> 8;
+}
+
+// Preload the colour of each band, and the brightness curve.
+// The curve matches the value scaling that setHSV() applies, so the LUT renderer looks the same.
+void  initBandPalette(int numberBands) {
+  hueStep = TOP_HUE_NUMBER / numberBands;   // How much the LED Hue changes for each step.
+
+  for (int band = 0; band < NUM_BANDS; band++) {
+    hsv2rgb_rainbow(CHSV((uint8_t)(band * hueStep), 255, 255), bandColor[band]);
+  }
+
+  for (int i = 0; i <= MAX_LED_BRIGHTNESS; i++) {
+    brightnessLUT[i] = ((i * i) >> 8) + (i ? 1 : 0);
+  }
+}
+
+// Render one LED per band straight from the band values.  No per pixel HSV maths or branches.
+void  renderBands(uint32_t * bandValues) {
+  for (int band = 0; band < NUM_BANDS; band++) {
+    uint32_t  value = bandValues[band];
+    value = (value < MAX_LED_BRIGHTNESS) ? value : MAX_LED_BRIGHTNESS;
+    scaleColor(leds[band], bandColor[band], brightnessLUT[value]);
+  }
+}
+
 void  showMode () {
-  FastLED.clearData();
-  FastLED.show();
+  clearLEDs();
+  showLEDs();
   for (int I = 0; I < displayMode; I++) {
     setLEDBand(I * 8, MAX_LED_BRIGHTNESS); 
   }
-  FastLED.show();
+  showLEDs();
 }
 
 // ======================================================================================================
@@ -162,58 +184,48 @@ void  initFFTDisplay(int numberBands) {
   highTrip  = HIGH_TRIP;
   
   numBands = numberBands;
-  hueStep = TOP_HUE_NUMBER / numBands;   // How much the LED Hue changes for each step.
 }
 
 // Update the LED string based on the intensities of all the Frequency bins.
 void  updateFFTDisplay (uint32_t * bandValues){
-  uint16_t ledBrightness;
-  
-  // Process the LED buckets into LED Intensities
-  for (byte band = 0; band < numBands; band++) {
-    
-    // Scale the bars for the display
-    ledBrightness = bandValues[band];
+  // Process the LED buckets into LED Intensities, each band in its own Hue.
+  renderBands(bandValues);
 
-    if (ledBrightness > MAX_LED_BRIGHTNESS)  {
-      ledBrightness = MAX_LED_BRIGHTNESS;
-    }
-  
-    // Display LED Band in the correct Hue.
-    setLEDBand(band, ledBrightness);
-  }
-  
   // Update LED display
-  FastLED.show();
+  showLEDs();
 }
 
 // ======================================================================================================
 //  Tone display functions
 // ======================================================================================================
 
-// Update the LED string based on the intensities of all the Frequency bins.
+// Light the pitch found by the pitch tracker.  A confident pitch is placed between two bands,
+// split in proportion to where its frequency falls, otherwise the loudest band is lit.
 void  updateToneDisplay (uint32_t * bandValues){
-  uint16_t ledBrightness = 0;
-  uint16_t maxBand = -1;
-
-  // Find the band with the strongets signal and light it up.
-  for (byte band = 0; band < numBands; band++) {
-    if (bandValues[band] > ledBrightness) {
-      ledBrightness = bandValues[band];
-      maxBand = band;
-    }
-  }
-   
+  const Pitch &pitch = readPitch();
+  bool     confident = (pitch.confidence >= PITCH_MIN_CONFIDENCE);
+  uint16_t ledBrightness = bandValues[confident ? pitch.band : pitch.loudest];
+
   if (ledBrightness > 0) {
-    FastLED.clearData();
+    clearLEDs();
     // Display LED Band in the correct Hue.
     if (ledBrightness > MAX_LED_BRIGHTNESS)  {
       ledBrightness = MAX_LED_BRIGHTNESS;
     }
 
     // Update LED display
-    setLEDBand(maxBand, ledBrightness);
-    FastLED.show();
+    if (confident) {
+      int   lower    = (int)pitch.position;
+      float fraction = pitch.position - lower;
+
+      setLEDBand(lower, ledBrightness * (1.0 - fraction));
+      if ((fraction > 0) && (lower + 1 < numBands)) {
+        setLEDBand(lower + 1, ledBrightness * fraction);
+      }
+    } else {
+      setLEDBand(pitch.loudest, ledBrightness);
+    }
+    showLEDs();
   }
 }
 
@@ -225,7 +237,6 @@ void  updateToneDisplay (uint32_t * bandValues){
 // Configure the LED string and preload the color values for each band.
 void  initBallDisplay(int numberBands) {
   numBands = numberBands;
-  hueStep = TOP_HUE_NUMBER / numBands;   // How much the LED Hue changes for each step.
 
   const double MIN_GAIN_SCALE  = 0.001;
   const double MAX_GAIN_SCALE  = 0.05;
@@ -237,11 +248,8 @@ void  initBallDisplay(int numberBands) {
   lowTrip   = LOW_TRIP;
   highTrip  = HIGH_TRIP;
 
-  // initialize ball data;
-  memset(pos, 0, sizeof(pos));
-  memset(vel, 0, sizeof(vel));
-  memset(band, 0, sizeof(band));
-  memset(numBalls, 0, sizeof(numBalls));
+  initBalls();
+  clearOnsets();
 }
 
 void updateBallDisplay (uint32_t * bandValues){
@@ -254,89 +262,75 @@ void updateBallDisplay (uint32_t * bandValues){
 }
 
 void  addBalls(uint32_t * bandValues){
+    OnsetEvent onset;
+    
+    if (BALLS_ON_ONSETS) {
+      // launch from the loud bands of each range that just had an onset
+      while (readOnset(onset)) {
+        addBandBalls(bandValues, onset.firstBand, min((int)onset.lastBand, numBands - 1));
+      }
+    } else {
+      addBandBalls(bandValues, 0, numBands - 1);
+    }
+}
+
+void  addBandBalls(uint32_t * bandValues, int firstBand, int lastBand){
     uint32_t val;
-    double   velocity;
     
-    for (int b = 0; b < numBands; b++ ){
+    for (int b = firstBand; b <= lastBand; b++ ){
       val = bandValues[b];
       if (val > MAX_LED_BRIGHTNESS) {
           val = MAX_LED_BRIGHTNESS;
       }
       
       if (val > BALL_THRESHOLD) {
-        velocity = (double)val / 100.0;
-        addBall(velocity, b);
+        addBall((float)val * 0.01f, b);
       }
     }
 }
 
-void  addBall(float avel, int  aband) {
-
-    // add new ball to end of list of there is room
-    if (nextBall < MAX_BALLS) {
-
-      if (numBalls[aband] < MAX_BAND_BALLS) {
-        pos[nextBall] = 0;
-        vel[nextBall] = avel;
-        band[nextBall] = aband;
-  
-        numBalls[aband]++;
-        nextBall++;
-      } else {
-      }
-    }
+// Balls are drawn at the strips' own resolution, not the logical frame's.
+void  displayBalls() {
+    clearLEDs();
+    drawBalls(setLEDSpot, bandColor);
+    showLEDs();
 }
 
-void  moveBalls() {
-    uint32_t tnow     = millis();  
-    double elapsed = (double)(tnow - lastMoveMs) * 0.001;  
-
-    double deltaV        = GRAVITY * elapsed ;
-    double halfATSquared = deltaV  * elapsed * 0.5 ;
-
-    // process each ball
-    for (int ball = 0; ball < nextBall; ball++) {
-      pos[ball] += (halfATSquared + (vel[ball] * elapsed)); 
-      vel[ball] += deltaV  ;
+// ======================================================================================================
+//  VU Meter display
+// ======================================================================================================
 
-      // has the ball hit the ground?
-      if (pos[ball] <= 0) {
+void  initVuDisplay() {
+  orangeLED   = (int)((ORANGE_DB - MIN_DB) / DB_PER_LED);
+  redLED      = (int)((RED_DB    - MIN_DB) / DB_PER_LED);
 
-        // remove this ball and move all others down.
-        nextBall--;
-        numBalls[band[ball]]--;
-        
-        for (int b = ball; b < nextBall; b++) {
-          pos[b] = pos[b+1];
-          vel[b] = vel[b+1];
-          band[b] = band[b+1];
-        }
-      }
-    }
-    lastMoveMs =tnow;
+  for (int i = 0; i < (1 << VU_LOG_BITS); i++) {
+    dbLUT[i] = VU_DB_OFFSET + (VU_DB_PER_OCTAVE * log2(1.0 + ((double)i / (1 << VU_LOG_BITS))));
+  }
 }
 
-void  displayBalls() {
+// Convert a raw peak to peak sample range into dB.  The octave comes from the top bit, the rest from the LUT.
+float levelToDb(uint16_t p2p) {
+  uint32_t  value  = p2p ? p2p : 1;
+  int       octave = 31 - __builtin_clz(value);
+  uint32_t  mantissa;
 
-    // process each ball
-    FastLED.clearData();
-    for (int ball = 0; ball < nextBall; ball++) {
-      setLED((int)(pos[ball] * LED_PER_METER), band[ball] * hueStep, MAX_LED_BRIGHTNESS); 
-    }  
-    
-    FastLED.show();
-}
+  if (octave >= VU_LOG_BITS) {
+    mantissa = value >> (octave - VU_LOG_BITS);
+  } else {
+    mantissa = value << (VU_LOG_BITS - octave);
+  }
 
-// ======================================================================================================
-//  VU Meter display
-// ======================================================================================================
+  return (dbLUT[mantissa & ((1 << VU_LOG_BITS) - 1)] + (octave * (float)VU_DB_PER_OCTAVE));
+}
 
-void  updateVuDisplay(double p2p) {
-  double  db = (9.1024 * log(p2p)) + 115.82;
+// Called once per analysis frame with the frame's peak to peak sample range.
+void  updateVuDisplay(uint16_t p2p) {
+  float   db = levelToDb(p2p);
 
   if (millis() > modeChangeRelease) {
-    levelFilter = spikeFilter(levelFilter, db, 0.2, 0.05);
-    peakFilter  = spikeFilter(peakFilter,  db, 1.0, 0.001);
+    levelFilter = spikeFilter(levelFilter, db, 0.59, 0.185);
+    peakFilter  = spikeFilter(peakFilter,  db, 1.0,  0.004);
   
     int levelLED    = (int)((levelFilter - MIN_DB) / DB_PER_LED);
     int peakLED     = (int)((peakFilter  - MIN_DB) / DB_PER_LED);
@@ -346,7 +340,7 @@ void  updateVuDisplay(double p2p) {
     }
   
     // run up from bottom of display to top.
-    FastLED.clearData();
+    clearLEDs();
     short hue = 96;
     for (short l=0; l < NUM_LEDS; l++) {
       if (l >= redLED)
@@ -364,7 +358,7 @@ void  updateVuDisplay(double p2p) {
                   
     }
   
-    FastLED.show();
+    showLEDs();
   }
 
   /*
@@ -375,7 +369,7 @@ void  updateVuDisplay(double p2p) {
   */
 }
 
-double  spikeFilter(double filter, double live, double upTC, double downTC){
+float   spikeFilter(float filter, float live, float upTC, float downTC){
   if (live > filter) {
     filter += ((live - filter) * upTC); 
   } else {
@@ -5,20 +5,21 @@
 #ifndef display_H /* Prevent loading library twice */
 #define display_H
 
+#include "ledOutput.h"
+#include "ballPhysics.h"
+
 #define MODE_CHANGE_PAUSE   1000
 
 #define BALL_THRESHOLD      50
-#define MAX_BALLS           40                  // maximum number of balls in the air
-#define MAX_BAND_BALLS       1
+#define BALLS_ON_ONSETS   true                  // Only launch balls when a range has an onset (see onsetDetector.h)
 #define MAX_LED_BRIGHTNESS 255
 #define DIM_LED_BRIGHTNESS  15
 
 #define TOP_HUE_NUMBER      240.0
 
-//#define GRAVITY          -2.0                //  
-#define GRAVITY            -1.9                //  was 1.5
-
-#define LED_PER_METER       60
+#define VU_LOG_BITS          6                  // Size of the dB LUT (64 entries per octave)
+#define VU_DB_PER_OCTAVE    (9.1024 * 0.6931472)            // dB per doubling of the peak to peak range
+#define VU_DB_OFFSET        (115.82 - (9.1024 * 11.090339)) // dB of a peak to peak range of 1 (of 65535)
 
 extern double minScale;
 extern double gainSlope;
@@ -32,6 +33,7 @@ void  showMode();
 
 void  initDisplay() ;
 void  updateDisplay (uint32_t * bandValues);
+bool  displayIdle();
 
 void  initFFTDisplay(int numBands) ;
 void  initBallDisplay(int numBands) ;
@@ -39,18 +41,21 @@ void  initBallDisplay(int numBands) ;
 void  updateFFTDisplay (uint32_t * bandValues);
 void  updateToneDisplay (uint32_t * bandValues);
 void  updateBallDisplay (uint32_t * bandValues);
-void  updateVuDisplay(double  peakToPeak);
-
-int   flipLEDs(int num);
+void  initVuDisplay();
+void  updateVuDisplay(uint16_t  peakToPeak);
+float levelToDb(uint16_t peakToPeak);
 
 void  addBalls(uint32_t * bandValues);
-void  addBall(float vel, int  band);
-void  moveBalls();
+void  addBandBalls(uint32_t * bandValues, int firstBand, int lastBand);
 void  displayBalls();
 
-double  spikeFilter(double filter, double live, double upTC, double downTC);
+float   spikeFilter(float filter, float live, float upTC, float downTC);
+
+void  initBandPalette(int numberBands);
+void  renderBands(uint32_t * bandValues);
+void  scaleColor(CRGB &led, const CRGB &color, uint16_t scale);
 
 void  setLED(int pos, int hue, int intensity);
-void  setLEDBand(int pos,  int band,  int intensity);
+void  setLEDBand(int band,  int intensity);
 
 #endif
@@ -0,0 +1,399 @@
+/*
+  Accuracy vs Speed Harness (host side).
+
+  Runs the device's analysis chain (BufferManager -> arduinoFFT_float -> band mapping) in each of
+  its configurations on the same synthetic signals, and compares every band of every frame with a
+  double precision reference.  The reference works straight from the full rate input, so it also
+  shows what the decimation costs:  for each bin it evaluates the DFT over the window's full span
+  of input samples (Goertzel, in double), with the same Hamming window and scaling.
+
+  Signals:  tone    single tones stepping through 13 frequencies from 60 Hz to 16 kHz
+            chirp   log sweep from 40 Hz to 16 kHz
+            noise   white noise
+
+  Reported per configuration:
+    frames/s     chain throughput (one core), and as a multiple of realtime at 44.1 kHz
+    SNR          reference band energy / error energy, per signal, in dB
+    worst band   error energy of the worst band relative to its own energy, in dB
+    > 0 dB       bands whose error is at or above their own energy:  outputting 0 would do as well
+    leakage      tone energy landing more than one band away from the tone, in dB
+  With "bands", the error of every band in every configuration is listed as well.
+
+  To try another implementation, add a Candidate to candidates() below.
+
+  g++ -std=c++11 -O2 -Icompat -o accuracyHarness accuracyHarness.cpp \
+      ../bufferManager.cpp ../arduinoFFT_float.cpp
+  ./accuracyHarness [bands]
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../devconf.h"
+#include "../bandMapper.h"
+#include "../qualityPlan.h"
+#include "../arduinoFFT_float.h"
+#include "../bufferManager.h"
+
+#define SAMPLE_RATE     44100.0
+#define HOP             512                       // Input samples per frame
+#define RANGES          3
+#define FFT_SAMPLES     1024
+#define WARMUP_FRAMES   32                        // Frames before the LO window is full
+#define TONE_FRAMES     40                        // Frames each test tone is held
+#define TONE_SCORED     8                         // Last frames of each tone used for leakage
+#define SIGNAL_FRAMES   240                       // Length of the chirp and noise signals
+
+static const uint16_t LO_bandBins[NUM_LO_BANDS + 1] = LO_BAND_BINS;
+static const uint16_t MD_bandBins[NUM_MD_BANDS + 1] = MD_BAND_BINS;
+static const uint16_t HI_bandBins[NUM_HI_BANDS + 1] = HI_BAND_BINS;
+
+static const uint16_t *rangeBins[RANGES]  = { LO_bandBins, MD_bandBins, HI_bandBins };
+static const uint16_t  rangeBands[RANGES] = { NUM_LO_BANDS, NUM_MD_BANDS, NUM_HI_BANDS };
+static const uint16_t  rangeSkip[RANGES]  = { 16, 8, 1 };
+
+static const float     zeroThreshold[FFT_SAMPLES] = { 0 };
+
+// ======================================================================================================
+// Signals
+// ======================================================================================================
+
+struct Signal {
+  const char          *name;
+  std::vector<short>   samples;
+  std::vector<double>  toneHz;                    // Tone frequency of each frame, 0 if not a tone
+};
+
+static std::vector<Signal>  makeSignals(void) {
+  std::vector<Signal>  signals(3);
+  std::mt19937         random(1);
+  std::normal_distribution<double> noise(0.0, 4000.0);
+
+  // tones, a little off the bin centres
+  signals[0].name = "tone";
+  for (int t = 0; t < 13; t++) {
+    double  hz = 60.0 * pow(16000.0 / 60.0, t / 12.0) * 1.013;
+    for (int f = 0; f < TONE_FRAMES; f++) {
+      for (int s = 0; s < HOP; s++) {
+        double  n = (double)signals[0].samples.size();
+        signals[0].samples.push_back((short)(8000 * sin(2 * M_PI * hz * n / SAMPLE_RATE)));
+      }
+      signals[0].toneHz.push_back((f >= TONE_FRAMES - TONE_SCORED) ? hz : 0);
+    }
+  }
+
+  signals[1].name = "chirp";
+  signals[2].name = "noise";
+  double  phase = 0;
+  for (long n = 0; n < (long)SIGNAL_FRAMES * HOP; n++) {
+    double  hz = 40.0 * pow(16000.0 / 40.0, (double)n / (SIGNAL_FRAMES * HOP));
+    phase += 2 * M_PI * hz / SAMPLE_RATE;
+    signals[1].samples.push_back((short)(8000 * sin(phase)));
+    signals[2].samples.push_back((short)std::max(-32768.0, std::min(32767.0, noise(random))));
+  }
+  signals[1].toneHz.assign(SIGNAL_FRAMES, 0);
+  signals[2].toneHz.assign(SIGNAL_FRAMES, 0);
+  return signals;
+}
+
+// ======================================================================================================
+// Reference:  double precision, full rate
+// ======================================================================================================
+
+// Band values of the frame ending at input sample end.  The window of range r covers
+// FFT_SAMPLES * skip input samples.  Each input sample is weighted by the Hamming window at the
+// centre of the decimated sample it falls in, and divided by skip (the decimator averages).
+static void  referenceFrame(const std::vector<short> &x, long end, double *bandValues) {
+  int  band = 0;
+
+  for (int r = 0; r < RANGES; r++) {
+    int     skip  = rangeSkip[r];
+    long    span  = (long)FFT_SAMPLES * skip;
+    long    start = end - span;
+    std::vector<double> windowed(span);
+    double  mean = 0;
+
+    for (long m = 0; m < span; m++) {
+      mean += (start + m >= 0) ? x[start + m] : 0;
+    }
+    mean /= span;
+
+    for (long m = 0; m < span; m++) {
+      double  value = ((start + m >= 0) ? x[start + m] : 0) - mean;
+      double  t     = (m / skip);
+      double  w     = 0.54 - 0.46 * cos(2 * M_PI * t / (FFT_SAMPLES - 1));
+      windowed[m] = value * w / skip;
+    }
+
+    // Goertzel for every bin the bands of this range use
+    uint16_t  firstBin = rangeBins[r][0];
+    uint16_t  lastBin  = rangeBins[r][rangeBands[r]];
+    std::vector<double> mag(lastBin + 1, 0.0);
+    for (uint16_t k = firstBin; k <= lastBin; k++) {
+      double  omega = 2 * M_PI * k / (double)span;
+      double  coef  = 2 * cos(omega);
+      double  s1 = 0, s2 = 0;
+      for (long m = 0; m < span; m++) {
+        double  s0 = windowed[m] + coef * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+      }
+      mag[k] = sqrt(std::max(0.0, s1 * s1 + s2 * s2 - coef * s1 * s2));
+    }
+
+    for (int b = 0; b < rangeBands[r]; b++, band++) {
+      double  sum = 0;
+      for (uint16_t k = rangeBins[r][b]; k <= rangeBins[r][b + 1]; k++) {
+        sum += mag[k];
+      }
+      bandValues[band] = sum;
+    }
+  }
+}
+
+// ======================================================================================================
+// Chains under test
+// ======================================================================================================
+
+// The device chain at one of the analyser's quality steps (see audioAnalyzer.h).  Noise thresholds
+// are left at zero, so only the signal path is measured.
+class DeviceChain
+{
+public:
+  DeviceChain(int quality) {
+    _quality  = quality;
+    _oddFrame = false;
+    memset(_short, 0, sizeof(_short));
+    for (int r = 0; r < RANGES; r++) {
+      _FFT[r]    = arduinoFFT_float(_vReal[r], _vImag[r], _weights[r], FFT_SAMPLES, SAMPLE_RATE / rangeSkip[r], FFT_WIN_TYP_HAMMING);
+      _buffer[r] = BufferManager(_vReal[r], _weights[r], _short[r], FFT_SAMPLES, rangeSkip[r]);
+    }
+  }
+
+  void  process(const short *samples, uint32_t *bandValues) {
+    QualityPlan plan = qualityPlan(_quality, _oddFrame);
+    _oddFrame = !_oddFrame;
+
+    for (int r = 0; r < RANGES; r++) {
+      for (int s = 0; s < HOP; s++) {
+        _buffer[r].addSample(samples[s]);
+      }
+    }
+
+    if (plan.doLO) {
+      run(0, plan.window, FFT_SAMPLES);
+      mapBands(_vReal[0], zeroThreshold, LO_bandBins, NUM_LO_BANDS, _bands);
+    }
+    if (plan.doMD) {
+      run(1, plan.window, FFT_SAMPLES);
+      mapBands(_vReal[1], zeroThreshold, MD_bandBins, NUM_MD_BANDS, _bands + NUM_LO_BANDS);
+    }
+
+    // the half size HI FFT is read as AudioAnalyzeFFT::readBand() reads it
+    uint8_t  hiShift = plan.halfHI ? 1 : 0;
+    run(2, plan.window, FFT_SAMPLES >> hiShift);
+    uint32_t *hiBands = _bands + NUM_LO_BANDS + NUM_MD_BANDS;
+    if (hiShift) {
+      mapShiftedBands(_vReal[2], zeroThreshold, HI_bandBins, NUM_HI_BANDS, hiShift, hiBands);
+    } else {
+      mapBands(_vReal[2], zeroThreshold, HI_bandBins, NUM_HI_BANDS, hiBands);
+    }
+
+    memcpy(bandValues, _bands, sizeof(_bands));
+  }
+
+private:
+  void  run(int r, bool window, unsigned short samples) {
+    _buffer[r].transfer(1.0, window, samples);
+    _FFT[r].setSamples(samples);
+    _FFT[r].RunFFT();
+  }
+
+  int       _quality;
+  bool      _oddFrame;
+  short     _short[RANGES][FFT_SAMPLES];
+  float     _vReal[RANGES][FFT_SAMPLES];
+  float     _vImag[RANGES][FFT_SAMPLES];
+  float     _weights[RANGES][FFT_SAMPLES];
+  uint32_t  _bands[NUM_BANDS];
+  arduinoFFT_float  _FFT[RANGES];
+  BufferManager     _buffer[RANGES];
+};
+
+struct Candidate {
+  const char  *name;
+  std::function<std::function<void(const short *, uint32_t *)>(void)> make;   // Fresh state per signal
+};
+
+static std::vector<Candidate>  candidates(void) {
+  const char  *names[QUALITY_LEVELS] = { "full", "alternate", "rectangle", "half HI" };
+  std::vector<Candidate>  list;
+
+  for (int q = QUALITY_FULL; q < QUALITY_LEVELS; q++) {
+    Candidate  candidate;
+    candidate.name = names[q];
+    candidate.make = [q]() {
+      std::shared_ptr<DeviceChain> chain(new DeviceChain(q));
+      return std::function<void(const short *, uint32_t *)>([chain](const short *samples, uint32_t *bands) {
+        chain->process(samples, bands);
+      });
+    };
+    list.push_back(candidate);
+  }
+  return list;
+}
+
+// ======================================================================================================
+// Scoring
+// ======================================================================================================
+
+struct Score {
+  std::vector<double> errSq;                      // Per band
+  std::vector<double> refSq;
+  double    leakSum;
+  int       leakFrames;
+  Score() : errSq(NUM_BANDS, 0.0), refSq(NUM_BANDS, 0.0), leakSum(0), leakFrames(0) {}
+};
+
+static double  dB(double ratio) {
+  return (ratio > 0) ? 10 * log10(ratio) : -999;
+}
+
+// Share of a frame's energy more than one band away from its loudest band
+template <typename T> static double  leakage(const T *bands) {
+  int     peak = 0;
+  double  total = 0, outside = 0;
+
+  for (int b = 0; b < NUM_BANDS; b++) {
+    peak = (bands[b] > bands[peak]) ? b : peak;
+  }
+  for (int b = 0; b < NUM_BANDS; b++) {
+    double  energy = (double)bands[b] * bands[b];
+    total   += energy;
+    outside += (abs(b - peak) > 1) ? energy : 0;
+  }
+  return (total > 0) ? outside / total : 0;
+}
+
+int  main(int argc, char **argv) {
+  bool  showBands = (argc > 1) && !strcmp(argv[1], "bands");
+  std::vector<Signal>     signals = makeSignals();
+  std::vector<Candidate>  list    = candidates();
+  std::vector<std::vector<Score> > scores(list.size(), std::vector<Score>(signals.size()));
+  std::vector<double>     seconds(list.size(), 0.0);
+  std::vector<long>       frames(list.size(), 0);
+  double                  refLeakSum = 0;
+  int                     refLeakFrames = 0;
+
+  for (size_t s = 0; s < signals.size(); s++) {
+    const Signal  &signal = signals[s];
+    long           count  = signal.samples.size() / HOP;
+
+    // reference first, then every candidate over the same frames
+    std::vector<std::vector<double> > reference(count, std::vector<double>(NUM_BANDS));
+    for (long f = WARMUP_FRAMES; f < count; f++) {
+      referenceFrame(signal.samples, (f + 1) * HOP, reference[f].data());
+      if (signal.toneHz[f] > 0) {
+        refLeakSum += leakage(reference[f].data());
+        refLeakFrames++;
+      }
+    }
+
+    for (size_t c = 0; c < list.size(); c++) {
+      auto      chain = list[c].make();
+      Score    &score = scores[c][s];
+      uint32_t  bands[NUM_BANDS];
+
+      for (long f = 0; f < count; f++) {
+        auto start = std::chrono::steady_clock::now();
+        chain(&signal.samples[f * HOP], bands);
+        seconds[c] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        frames[c]++;
+
+        if (f < WARMUP_FRAMES) {
+          continue;
+        }
+        for (int b = 0; b < NUM_BANDS; b++) {
+          double  error = (double)bands[b] - reference[f][b];
+          score.errSq[b] += error * error;
+          score.refSq[b] += reference[f][b] * reference[f][b];
+        }
+        if (signal.toneHz[f] > 0) {
+          score.leakSum += leakage(bands);
+          score.leakFrames++;
+        }
+      }
+    }
+  }
+
+  // summary table
+  printf("%-10s %10s %8s", "config", "frames/s", "x RT");
+  for (size_t s = 0; s < signals.size(); s++) {
+    printf("  SNR %-5s", signals[s].name);
+  }
+  printf(" %11s %7s %9s\n", "worst band", "> 0 dB", "leakage");
+  printf("%-10s %10s %8s", "reference", "-", "-");
+  for (size_t s = 0; s < signals.size(); s++) {
+    printf("  %9s", "-");
+  }
+  printf(" %11s %7s %9.1f\n", "-", "-", dB(refLeakSum / refLeakFrames));
+
+  for (size_t c = 0; c < list.size(); c++) {
+    double  rate  = frames[c] / seconds[c];
+    double  worst = -999;
+    int     over  = 0;
+
+    printf("%-10s %10.0f %8.0f", list[c].name, rate, rate * HOP / SAMPLE_RATE);
+    for (size_t s = 0; s < signals.size(); s++) {
+      double  err = 0, ref = 0;
+      for (int b = 0; b < NUM_BANDS; b++) {
+        err += scores[c][s].errSq[b];
+        ref += scores[c][s].refSq[b];
+      }
+      printf("  %9.1f", dB(ref / err));
+    }
+    for (int b = 0; b < NUM_BANDS; b++) {
+      double  err = 0, ref = 0;
+      for (size_t s = 0; s < signals.size(); s++) {
+        err += scores[c][s].errSq[b];
+        ref += scores[c][s].refSq[b];
+      }
+      worst = std::max(worst, dB(err / ref));
+      over += (err >= ref) ? 1 : 0;
+    }
+    printf(" %11.1f %7d %9.1f\n", worst, over, dB(scores[c][0].leakSum / scores[c][0].leakFrames));
+  }
+
+  // per band error, all signals together
+  if (showBands) {
+    printf("\n%-5s %-6s %9s %9s", "band", "range", "from Hz", "to Hz");
+    for (size_t c = 0; c < list.size(); c++) {
+      printf(" %10s", list[c].name);
+    }
+    printf("\n");
+
+    int  band = 0;
+    for (int r = 0; r < RANGES; r++) {
+      double  binHz = SAMPLE_RATE / rangeSkip[r] / FFT_SAMPLES;
+      for (int b = 0; b < rangeBands[r]; b++, band++) {
+        printf("%-5d %-6s %9.1f %9.1f", band, (r == 0) ? "LO" : (r == 1) ? "MD" : "HI",
+               rangeBins[r][b] * binHz, rangeBins[r][b + 1] * binHz);
+        for (size_t c = 0; c < list.size(); c++) {
+          double  err = 0, ref = 0;
+          for (size_t s = 0; s < signals.size(); s++) {
+            err += scores[c][s].errSq[band];
+            ref += scores[c][s].refSq[band];
+          }
+          printf(" %10.1f", dB(err / ref));
+        }
+        printf("\n");
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*
+  Ball Physics Benchmark (host side).
+
+  Runs the Fireworks display's particle engine (ballPhysics) with the pool held full, to measure
+  particle update throughput.  The per band limit is lifted so the pool can reach MAX_BALLS
+  (the device default of MAX_BAND_BALLS stops it at that many balls per band).
+
+  Each frame is one analysis frame (86 Hz, so about 6 physics steps):  move every ball, draw them
+  onto the physical LEDs through the segment table (as setLEDSpot() does), then relaunch the balls
+  that landed.  Reported per part, in ns per ball,
+  and as the number of balls that would fill one core at 86 frames/s.
+
+  ballBench [balls] [seconds]
+
+  g++ -std=c++11 -O2 -Icompat -o ballBench ballBench.cpp ../ballPhysics.cpp ../ledLayout.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <Arduino.h>
+#include "../devconf.h"
+#include "../ballPhysics.h"
+#include "../ledLayout.h"
+
+#define FRAME_RATE    (44100.0 / 512)
+#define FRAME_STEPS   ((int)(1000.0 / FRAME_RATE / BALL_STEP_MS + 0.5))
+
+static CRGB   spotFrame[NUM_LED_CHANNELS][MAX_CHANNEL_LEDS];
+static CRGB   bandColors[NUM_BANDS];
+
+// As setLEDSpot(), without the display.
+static void  plotSpot(float position, const CRGB &color) {
+  LedSpot spots[NUM_LED_SEGMENTS];
+  int     found = layoutSpots(position, spots, NUM_LED_SEGMENTS);
+
+  for (int s = 0; s < found; s++) {
+    spotFrame[spots[s].channel][spots[s].led] = color;
+  }
+}
+
+static double  nsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int  main(int argc, char **argv) {
+  int     balls   = (argc > 1) ? atoi(argv[1]) : MAX_BALLS;
+  double  seconds = (argc > 2) ? atof(argv[2]) : 2.0;
+  std::mt19937  random(1);
+  std::uniform_real_distribution<float> launch(0.5f, 2.55f);          // As addBandBalls():  band value / 100
+  int     nextBand = 0;
+  long    frames = 0, updates = 0, launches = 0;
+  double  moveNs = 0, drawNs = 0, launchNs = 0;
+
+  balls = std::min(std::max(balls, 1), MAX_BALLS);
+  for (int b = 0; b < NUM_BANDS; b++) {
+    bandColors[b] = CRGB(b, 255 - b, 128);
+  }
+
+  initLEDLayout();
+  initBalls();
+  setBallLimits(MAX_BALLS, 0);
+
+  std::chrono::steady_clock::time_point  start = std::chrono::steady_clock::now();
+  while (nsSince(start) < seconds * 1e9) {
+    std::chrono::steady_clock::time_point  t = std::chrono::steady_clock::now();
+    while (ballCount() < balls) {
+      addBall(launch(random), nextBand);
+      nextBand = (nextBand + 1) % NUM_BANDS;
+      launches++;
+    }
+    launchNs += nsSince(t);
+
+    t = std::chrono::steady_clock::now();
+    updates += ballCount();
+    stepBalls(FRAME_STEPS);
+    moveNs += nsSince(t);
+
+    t = std::chrono::steady_clock::now();
+    memset(spotFrame, 0, sizeof(spotFrame));
+    drawBalls(plotSpot, bandColors);
+    drawNs += nsSince(t);
+    frames++;
+  }
+
+  double  perBall = (moveNs + drawNs + launchNs) / updates;
+  printf("%d balls, %ld frames of %d steps, %ld launches\n", balls, frames, FRAME_STEPS, launches);
+  printf("move   %6.2f ns/ball\n", moveNs / updates);
+  printf("draw   %6.2f ns/ball\n", drawNs / updates);
+  printf("launch %6.2f ns/ball  (%.1f%% of the balls relaunched each frame)\n", launchNs / updates, 100.0 * launches / updates);
+  printf("total  %6.2f ns/ball, %.0f frames/s, %.0f balls would fill one core at %.0f frames/s\n",
+         perBall, frames / (nsSince(start) / 1e9), 1e9 / (FRAME_RATE * perBall), FRAME_RATE);
+  return 0;
+}
@@ -0,0 +1,337 @@
+/*
+  Band Frame Recording (host side).
+  See bandRecording.h
+*/
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bandRecording.h"
+
+// ======================================================================================================
+// Writer
+// ======================================================================================================
+
+RecordingWriter::RecordingWriter() {
+  _file = NULL;
+  _frames = 0;
+}
+
+RecordingWriter::~RecordingWriter() {
+  close();
+}
+
+bool  RecordingWriter::open(const char *path, const RecordingConfig &config) {
+  uint8_t   block[RECORDING_HEADER_BYTES];
+
+  close();
+  if ((config.bands == 0) || (config.bands > RECORDING_MAX_BANDS) || (config.ranges > RECORDING_MAX_RANGES)) {
+    return false;
+  }
+
+  _file = fopen(path, "wb");
+  if (!_file) {
+    return false;
+  }
+  setvbuf(_file, NULL, _IOFBF, RECORDING_WRITE_BUFFER);
+
+  memset(&_header, 0, sizeof(_header));
+  memcpy(_header.magic, RECORDING_MAGIC, sizeof(_header.magic));
+  _header.version       = RECORDING_VERSION;
+  _header.headerBytes   = RECORDING_HEADER_BYTES;
+  _header.frameBytes    = RECORDING_FRAME_BYTES(config.bands);
+  _header.indexInterval = RECORDING_INDEX_INTERVAL;
+  _header.config        = config;
+
+  // the header is rewritten with the counts when the recording is closed
+  memset(block, 0, sizeof(block));
+  memcpy(block, &_header, sizeof(_header));
+  if (fwrite(block, sizeof(block), 1, _file) != 1) {
+    fclose(_file);
+    _file = NULL;
+    return false;
+  }
+
+  _record.assign(_header.frameBytes, 0);
+  _index.clear();
+  _frames = 0;
+  _timeMs = 0;
+  _lastDeviceMs = 0;
+  return true;
+}
+
+// Append one frame.  deviceMs is the device's millis(), which is extended to 64 bits.
+bool  RecordingWriter::write(uint32_t deviceMs, uint32_t sequence, uint32_t flags, const uint32_t *values) {
+  RecordedFrame *record = (RecordedFrame *)_record.data();
+
+  if (!_file) {
+    return false;
+  }
+
+  // a step back (device reset) is treated as no time passing, so times never go backwards.
+  if (_frames == 0) {
+    _timeMs = deviceMs;
+  } else if ((uint32_t)(deviceMs - _lastDeviceMs) < 0x80000000UL) {
+    _timeMs += (uint32_t)(deviceMs - _lastDeviceMs);
+  }
+  _lastDeviceMs = deviceMs;
+
+  if ((_frames % RECORDING_INDEX_INTERVAL) == 0) {
+    RecordingIndexEntry entry = { _timeMs, _frames };
+    _index.push_back(entry);
+  }
+
+  record->timeMs   = _timeMs;
+  record->sequence = sequence;
+  record->flags    = flags;
+  memcpy(record->values, values, _header.config.bands * sizeof(uint32_t));
+
+  if (fwrite(record, _header.frameBytes, 1, _file) != 1) {
+    return false;
+  }
+  _frames++;
+  return true;
+}
+
+// Write the index and the final header.
+bool  RecordingWriter::close(void) {
+  bool  ok = true;
+
+  if (!_file) {
+    return false;
+  }
+
+  _header.frameCount  = _frames;
+  _header.indexOffset = RECORDING_HEADER_BYTES + (_frames * _header.frameBytes);
+  _header.indexCount  = _index.size();
+
+  if (!_index.empty()) {
+    ok = (fwrite(_index.data(), sizeof(RecordingIndexEntry), _index.size(), _file) == _index.size());
+  }
+  ok = ok && (fseek(_file, 0, SEEK_SET) == 0);
+  ok = ok && (fwrite(&_header, sizeof(_header), 1, _file) == 1);
+  ok = (fclose(_file) == 0) && ok;
+  _file = NULL;
+  return ok;
+}
+
+uint64_t  RecordingWriter::frameCount(void) const {
+  return _frames;
+}
+
+// ======================================================================================================
+// Reader
+// ======================================================================================================
+
+RecordingReader::RecordingReader() {
+  _map = NULL;
+  _mapBytes = 0;
+  _fd = -1;
+  _frames = NULL;
+  _frameCount = 0;
+  _frameBytes = 0;
+}
+
+RecordingReader::~RecordingReader() {
+  close();
+}
+
+bool  RecordingReader::open(const char *path) {
+  struct stat info;
+
+  close();
+  _fd = ::open(path, O_RDONLY);
+  if (_fd < 0) {
+    return false;
+  }
+  if ((fstat(_fd, &info) != 0) || (info.st_size < RECORDING_HEADER_BYTES)) {
+    close();
+    return false;
+  }
+
+  _mapBytes = info.st_size;
+  void *map = mmap(NULL, _mapBytes, PROT_READ, MAP_SHARED, _fd, 0);
+  if (map == MAP_FAILED) {
+    _mapBytes = 0;
+    close();
+    return false;
+  }
+  _map = (const uint8_t *)map;
+
+  memcpy(&_header, _map, sizeof(_header));
+  if ((memcmp(_header.magic, RECORDING_MAGIC, sizeof(_header.magic)) != 0) ||
+      (_header.version != RECORDING_VERSION) ||
+      (_header.headerBytes != RECORDING_HEADER_BYTES) ||
+      (_header.config.bands == 0) || (_header.config.bands > RECORDING_MAX_BANDS) ||
+      (_header.frameBytes != RECORDING_FRAME_BYTES(_header.config.bands))) {
+    close();
+    return false;
+  }
+
+  _frames     = _map + _header.headerBytes;
+  _frameBytes = _header.frameBytes;
+
+  // use the index if the recording was closed properly and it fits the file, otherwise rebuild it
+  // from the frames the file has room for.
+  uint64_t  sizeFrames = (_mapBytes - _header.headerBytes) / _frameBytes;
+  if (indexValid(sizeFrames)) {
+    const RecordingIndexEntry *index = (const RecordingIndexEntry *)(_map + _header.indexOffset);
+    _frameCount = _header.frameCount;
+    _index.assign(index, index + _header.indexCount);
+  } else {
+    // a closed recording's count, if it fits.  Otherwise drop any trailing record whose time goes
+    // backwards (eg: the end of an index that was written over the last frames).
+    _frameCount = ((_header.frameCount > 0) && (_header.frameCount <= sizeFrames)) ? _header.frameCount : sizeFrames;
+    while ((_frameCount > 1) && (frame(_frameCount - 1)->timeMs < frame(_frameCount - 2)->timeMs)) {
+      _frameCount--;
+    }
+    buildIndex();
+  }
+  return true;
+}
+
+// True if the header's frame count and index are inside the file, and the index entries point at
+// those frames in order.  Sizes come from the file, so every sum is checked before it is made.
+bool  RecordingReader::indexValid(uint64_t sizeFrames) const {
+  uint64_t  framesEnd;
+  const RecordingIndexEntry *index;
+
+  if ((_header.indexCount == 0) || (_header.frameCount > sizeFrames)) {
+    return false;
+  }
+  framesEnd = _header.headerBytes + (_header.frameCount * _frameBytes);
+  if ((_header.indexOffset < framesEnd) || (_header.indexOffset > _mapBytes) ||
+      (_header.indexCount > (_mapBytes - _header.indexOffset) / sizeof(RecordingIndexEntry)) ||
+      ((_header.indexOffset % alignof(RecordingIndexEntry)) != 0)) {
+    return false;
+  }
+
+  index = (const RecordingIndexEntry *)(_map + _header.indexOffset);
+  for (uint64_t i = 0; i < _header.indexCount; i++) {
+    if ((index[i].frame >= _header.frameCount) || ((i > 0) && (index[i].frame <= index[i - 1].frame))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void  RecordingReader::close(void) {
+  if (_map) {
+    munmap((void *)_map, _mapBytes);
+  }
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+  _map = NULL;
+  _mapBytes = 0;
+  _fd = -1;
+  _frames = NULL;
+  _frameCount = 0;
+  _index.clear();
+}
+
+void  RecordingReader::buildIndex(void) {
+  _index.clear();
+  for (uint64_t f = 0; f < _frameCount; f += RECORDING_INDEX_INTERVAL) {
+    RecordingIndexEntry entry = { frame(f)->timeMs, f };
+    _index.push_back(entry);
+  }
+}
+
+uint64_t  RecordingReader::frameCount(void) const {
+  return _frameCount;
+}
+
+uint16_t  RecordingReader::bands(void) const {
+  return _header.config.bands;
+}
+
+const RecordingConfig &RecordingReader::config(void) const {
+  return _header.config;
+}
+
+// Return a pointer straight into the mapped file, or NULL if there is no such frame.
+const RecordedFrame *RecordingReader::frame(uint64_t frame) const {
+  if (frame >= _frameCount) {
+    return NULL;
+  }
+  return (const RecordedFrame *)(_frames + (frame * _frameBytes));
+}
+
+// Return the first frame at or after timeMs (frameCount() if there is none).
+uint64_t  RecordingReader::findFrame(uint64_t timeMs) const {
+  uint64_t  low  = 0;
+  uint64_t  high = _frameCount;
+
+  if (_index.empty()) {
+    return _frameCount;
+  }
+
+  // narrow down to one index interval, then search the frames within it
+  size_t  entry = 0;
+  size_t  count = _index.size();
+  while (count > 0) {
+    size_t  step = count / 2;
+    if (_index[entry + step].timeMs < timeMs) {
+      entry += step + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+  if (entry > 0) {
+    low = _index[entry - 1].frame;
+  }
+  if (entry < _index.size()) {
+    high = _index[entry].frame;
+  }
+
+  while (low < high) {
+    uint64_t  middle = low + ((high - low) / 2);
+    if (frame(middle)->timeMs < timeMs) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// Fill maxValues[bands] with the largest value of each band from fromMs to toMs (inclusive).
+// Returns the number of frames in the range.
+uint64_t  RecordingReader::rangeMax(uint64_t fromMs, uint64_t toMs, uint32_t *maxValues) const {
+  uint64_t  first = findFrame(fromMs);
+  uint64_t  last  = findFrame(toMs + 1);
+  uint16_t  bands = _header.config.bands;
+
+  memset(maxValues, 0, bands * sizeof(uint32_t));
+  for (uint64_t f = first; f < last; f++) {
+    const uint32_t *values = frame(f)->values;
+    for (uint16_t b = 0; b < bands; b++) {
+      maxValues[b] = (values[b] > maxValues[b]) ? values[b] : maxValues[b];
+    }
+  }
+  return (last > first) ? (last - first) : 0;
+}
+
+// Fill meanValues[bands] with the average of each band from fromMs to toMs (inclusive).
+// Returns the number of frames in the range.
+uint64_t  RecordingReader::rangeMean(uint64_t fromMs, uint64_t toMs, float *meanValues) const {
+  uint64_t  first = findFrame(fromMs);
+  uint64_t  last  = findFrame(toMs + 1);
+  uint16_t  bands = _header.config.bands;
+  std::vector<double> sums(bands, 0.0);
+
+  for (uint64_t f = first; f < last; f++) {
+    const uint32_t *values = frame(f)->values;
+    for (uint16_t b = 0; b < bands; b++) {
+      sums[b] += values[b];
+    }
+  }
+  for (uint16_t b = 0; b < bands; b++) {
+    meanValues[b] = (last > first) ? (float)(sums[b] / (last - first)) : 0;
+  }
+  return (last > first) ? (last - first) : 0;
+}
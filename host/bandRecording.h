@@ -0,0 +1,129 @@
+/*
+  Band Frame Recording (host side).
+
+  A file format for storing long sessions of band frames (the output of fillBands()) and a reader
+  that memory maps it for zero copy random access.
+
+  File layout:
+    RecordingHeader   fixed 4096 bytes.  Band and bin configuration, frame and index locations.
+    frames            frameCount fixed size records:  timeMs (64 bit), sequence, flags, values[bands]
+    index             indexCount RecordingIndexEntry, one per RECORDING_INDEX_INTERVAL frames
+
+  Frame times are kept as a 64 bit millisecond count, extended from the device's 32 bit millis(),
+  and must never go backwards, so a time can be found by binary search.  The index is written when
+  the recording is closed.  If a recording was never closed (eg: a crash), the reader works out the
+  frame count from the file size and rebuilds the index itself.  It does the same if the header's
+  frame count or index don't fit the file.
+
+  POSIX (mmap) and C++11, eg:  g++ -std=c++11 -O2 -c bandRecording.cpp
+*/
+
+#ifndef bandRecording_h /* Prevent loading library twice */
+#define bandRecording_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+#define RECORDING_MAGIC           "VEBANDS1"
+#define RECORDING_VERSION         1
+#define RECORDING_HEADER_BYTES    4096
+#define RECORDING_MAX_BANDS       255
+#define RECORDING_MAX_RANGES      4
+#define RECORDING_INDEX_INTERVAL  1024              // Frames between index entries
+#define RECORDING_WRITE_BUFFER    (1 << 20)         // stdio buffer used by the writer
+
+// How the bands were made.  Filled in by whoever starts the recording.
+struct RecordingConfig {
+  uint16_t  bands;                                  // Total number of bands in each frame
+  uint16_t  ranges;                                 // Number of FFT ranges (LO, MD, HI ...)
+  uint16_t  rangeBands[RECORDING_MAX_RANGES];       // Number of bands from each range
+  uint16_t  fftSamples[RECORDING_MAX_RANGES];       // FFT size of each range
+  float     samplingFreq[RECORDING_MAX_RANGES];     // Sample rate of each range (after decimation)
+  uint16_t  bandFirstBin[RECORDING_MAX_BANDS];      // First FFT bin of each band, within its range
+  uint16_t  bandLastBin[RECORDING_MAX_BANDS];       // Last FFT bin of each band (inclusive)
+  float     frameRate;                              // Nominal frames per second
+};
+
+struct RecordingHeader {
+  char      magic[8];
+  uint32_t  version;
+  uint32_t  headerBytes;
+  uint32_t  frameBytes;                             // Size of one frame record
+  uint32_t  indexInterval;
+  uint64_t  frameCount;                             // 0 until the recording is closed
+  uint64_t  indexOffset;
+  uint64_t  indexCount;
+  RecordingConfig config;
+};
+
+struct RecordingIndexEntry {
+  uint64_t  timeMs;
+  uint64_t  frame;
+};
+
+// Fixed part of every frame record.  values[bands] follows it.
+struct RecordedFrame {
+  uint64_t  timeMs;
+  uint32_t  sequence;
+  uint32_t  flags;
+  uint32_t  values[1];
+};
+
+#define RECORDING_FRAME_BYTES(bands)  (16u + ((bands) * 4u))
+
+// ======================================================================================================
+
+class RecordingWriter
+{
+public:
+  RecordingWriter();
+  ~RecordingWriter();
+  bool  open(const char *path, const RecordingConfig &config);
+  bool  write(uint32_t deviceMs, uint32_t sequence, uint32_t flags, const uint32_t *values);
+  bool  close(void);
+  uint64_t frameCount(void) const;
+
+private:
+  FILE           *_file;
+  RecordingHeader _header;
+  std::vector<RecordingIndexEntry> _index;
+  std::vector<uint8_t> _record;
+  uint64_t        _frames;
+  uint64_t        _timeMs;
+  uint32_t        _lastDeviceMs;
+};
+
+class RecordingReader
+{
+public:
+  RecordingReader();
+  ~RecordingReader();
+  bool  open(const char *path);
+  void  close(void);
+
+  uint64_t  frameCount(void) const;
+  uint16_t  bands(void) const;
+  const RecordingConfig &config(void) const;
+
+  const RecordedFrame *frame(uint64_t frame) const;
+  uint64_t  findFrame(uint64_t timeMs) const;
+  uint64_t  rangeMax(uint64_t fromMs, uint64_t toMs, uint32_t *maxValues) const;
+  uint64_t  rangeMean(uint64_t fromMs, uint64_t toMs, float *meanValues) const;
+
+private:
+  void  buildIndex(void);
+  bool  indexValid(uint64_t sizeFrames) const;
+
+  const uint8_t  *_map;
+  size_t          _mapBytes;
+  int             _fd;
+  RecordingHeader _header;
+  const uint8_t  *_frames;
+  uint64_t        _frameCount;
+  uint32_t        _frameBytes;
+  std::vector<RecordingIndexEntry> _index;
+};
+
+#endif
@@ -0,0 +1,298 @@
+/*
+  Band Tool (host side).
+
+  bandtool record <capture|tty|-> <out.rec>     Decode a telemetry stream into a recording
+  bandtool info   <file.rec>                    Show the recording configuration and length
+  bandtool max    <file.rec> <fromMs> <toMs>    Largest value of each band between two times
+  bandtool bench  <file.rec> <GB>               Writer and reader throughput on a file of that size
+  bandtool pipeline <sampleRate> <seconds> [paced]
+                                                Serial vs pipelined analysis of a synthetic stream,
+                                                as fast as possible, or paced at the real sample rate.
+                                                Shows the ranges and bands at that rate.
+
+  g++ -std=c++11 -O2 -pthread -Icompat -o bandtool bandtool.cpp bandRecording.cpp telemetryDecoder.cpp \
+      pipelineExecutor.cpp ../bufferManager.cpp ../arduinoFFT_float.cpp ../noiseTracker.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../devconf.h"
+#include "bandRecording.h"
+#include "telemetryDecoder.h"
+#include "pipelineExecutor.h"
+
+static const uint16_t LO_bandBins[NUM_LO_BANDS + 1] = LO_BAND_BINS;
+static const uint16_t MD_bandBins[NUM_MD_BANDS + 1] = MD_BAND_BINS;
+static const uint16_t HI_bandBins[NUM_HI_BANDS + 1] = HI_BAND_BINS;
+
+// ======================================================================================================
+
+static double  secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Describe the Visual Ear band layout (see devconf.h and audioAnalyzer.h).
+static void  visualEarConfig(RecordingConfig &config) {
+  const uint16_t *bins[3]  = { LO_bandBins, MD_bandBins, HI_bandBins };
+  const uint16_t  count[3] = { NUM_LO_BANDS, NUM_MD_BANDS, NUM_HI_BANDS };
+  const uint16_t  skip[3]  = { 16, 8, 1 };
+  int   band = 0;
+
+  memset(&config, 0, sizeof(config));
+  config.bands     = NUM_BANDS;
+  config.ranges    = 3;
+  config.frameRate = 44100.0 / 512;
+
+  for (int r = 0; r < 3; r++) {
+    config.rangeBands[r]   = count[r];
+    config.fftSamples[r]   = 1024;
+    config.samplingFreq[r] = 44100.0 / skip[r];
+    for (int b = 0; b < count[r]; b++, band++) {
+      config.bandFirstBin[band] = bins[r][b];
+      config.bandLastBin[band]  = bins[r][b + 1];
+    }
+  }
+}
+
+// ======================================================================================================
+
+static int  record(const char *from, const char *to) {
+  FILE             *input = strcmp(from, "-") ? fopen(from, "rb") : stdin;
+  RecordingConfig   config;
+  RecordingWriter   writer;
+  TelemetryDecoder  decoder;
+  uint8_t           buffer[4096];
+  size_t            length;
+  bool              ok = true;
+
+  if (!input) {
+    fprintf(stderr, "can't open %s\n", from);
+    return 1;
+  }
+  visualEarConfig(config);
+  if (!writer.open(to, config)) {
+    fprintf(stderr, "can't create %s\n", to);
+    return 1;
+  }
+
+  while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+    decoder.feed(buffer, length, [&](const BandFrame &frame) {
+      if (frame.bands == config.bands) {
+        ok = writer.write(frame.timeMs, frame.sequence, frame.key ? 1 : 0, frame.values) && ok;
+      }
+    });
+  }
+
+  const TelemetryStats &stats = decoder.stats();
+  printf("%llu frames recorded.  %u CRC errors, %u lost, %u skipped\n",
+         (unsigned long long)writer.frameCount(), stats.crcErrors, stats.lostFrames, stats.skippedFrames);
+
+  ok = writer.close() && ok;
+  if (input != stdin) {
+    fclose(input);
+  }
+  return ok ? 0 : 1;
+}
+
+static int  info(const char *path) {
+  RecordingReader reader;
+
+  if (!reader.open(path)) {
+    fprintf(stderr, "can't read %s\n", path);
+    return 1;
+  }
+
+  const RecordingConfig &config = reader.config();
+  uint64_t  frames = reader.frameCount();
+
+  printf("%u bands in %u ranges, %.2f frames/s\n", config.bands, config.ranges, config.frameRate);
+  for (int r = 0; r < config.ranges; r++) {
+    printf("  range %d: %u bands, %u point FFT at %.1f Hz\n", r, config.rangeBands[r], config.fftSamples[r], config.samplingFreq[r]);
+  }
+  printf("%llu frames", (unsigned long long)frames);
+  if (frames > 0) {
+    printf(", %llu ms to %llu ms", (unsigned long long)reader.frame(0)->timeMs, (unsigned long long)reader.frame(frames - 1)->timeMs);
+  }
+  printf("\n");
+  return 0;
+}
+
+static int  rangeMax(const char *path, uint64_t fromMs, uint64_t toMs) {
+  RecordingReader reader;
+  uint32_t        maxValues[RECORDING_MAX_BANDS];
+
+  if (!reader.open(path)) {
+    fprintf(stderr, "can't read %s\n", path);
+    return 1;
+  }
+
+  uint64_t frames = reader.rangeMax(fromMs, toMs, maxValues);
+  printf("%llu frames\n", (unsigned long long)frames);
+  for (int b = 0; b < reader.bands(); b++) {
+    printf("%d %u\n", b, maxValues[b]);
+  }
+  return 0;
+}
+
+// Write a recording of the requested size, then time sequential and random reads of it.
+static int  bench(const char *path, double gigabytes) {
+  RecordingConfig   config;
+  RecordingWriter   writer;
+  RecordingReader   reader;
+  uint32_t          values[NUM_BANDS];
+  uint32_t          maxValues[RECORDING_MAX_BANDS];
+  std::mt19937      random(1);
+
+  visualEarConfig(config);
+  uint64_t  frames = (uint64_t)(gigabytes * 1e9) / RECORDING_FRAME_BYTES(NUM_BANDS);
+  double    mb     = (double)frames * RECORDING_FRAME_BYTES(NUM_BANDS) / 1e6;
+
+  // writer.  Frames are 11-12 ms apart, like the real thing.
+  for (int b = 0; b < NUM_BANDS; b++) {
+    values[b] = random() & 0xFF;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (!writer.open(path, config)) {
+    fprintf(stderr, "can't create %s\n", path);
+    return 1;
+  }
+  for (uint64_t f = 0; f < frames; f++) {
+    values[f % NUM_BANDS] = random() & 0xFF;
+    if (!writer.write((uint32_t)((f * 1161) / 100), (uint32_t)f, 0, values)) {
+      fprintf(stderr, "write failed\n");
+      return 1;
+    }
+  }
+  if (!writer.close()) {
+    fprintf(stderr, "write failed\n");
+    return 1;
+  }
+  double  seconds = secondsSince(start);
+  printf("write:  %llu frames, %.0f MB in %.2f s.  %.0f MB/s, %.0f frames/s\n",
+         (unsigned long long)frames, mb, seconds, mb / seconds, frames / seconds);
+
+  // reader: open, then one query over the whole file
+  start = std::chrono::steady_clock::now();
+  if (!reader.open(path)) {
+    fprintf(stderr, "can't read %s\n", path);
+    return 1;
+  }
+  if (reader.frameCount() == 0) {
+    fprintf(stderr, "%s has no frames\n", path);
+    return 1;
+  }
+  uint64_t  lastMs = reader.frame(reader.frameCount() - 1)->timeMs;
+  uint64_t  seen   = reader.rangeMax(0, lastMs, maxValues);
+  seconds = secondsSince(start);
+  printf("scan:   %llu frames, %.0f MB in %.2f s.  %.0f MB/s, %.0f frames/s\n",
+         (unsigned long long)seen, mb, seconds, mb / seconds, seen / seconds);
+
+  // reader: random one second queries
+  const int queries = 10000;
+  uint64_t  total = 0;
+  start = std::chrono::steady_clock::now();
+  for (int q = 0; q < queries; q++) {
+    uint64_t from = random() % (lastMs + 1);
+    total += reader.rangeMax(from, from + 1000, maxValues);
+  }
+  seconds = secondsSince(start);
+  printf("seek:   %d one second queries (%llu frames) in %.3f s.  %.1f us/query\n",
+         queries, (unsigned long long)total, seconds, seconds * 1e6 / queries);
+  return 0;
+}
+
+// Run the same synthetic stream through the analysis serially and pipelined, and compare.
+// Tones, a repeating chirp and noise, so every range has something to do.
+// Flat out shows the throughput.  Paced shows the latency of a live stream.  "critical" is the mean
+// of the slowest range plus the mapping, per frame:  the latency the pipeline reaches with a core
+// for every stage (4), which a machine with fewer cores can't show directly.
+static int  pipeline(double sampleRate, double seconds, bool paced) {
+  uint64_t            hops = (uint64_t)(sampleRate * seconds) / PIPELINE_HOP;
+  std::vector<short>  input(hops * PIPELINE_HOP);
+  std::mt19937        random(1);
+  std::normal_distribution<double> noise(0.0, 200.0);
+  double              chirpPhase = 0;
+
+  for (size_t s = 0; s < input.size(); s++) {
+    double  t     = s / sampleRate;
+    double  sweep = 50.0 * pow(300.0, fmod(t, 2.0) / 2.0);    // 50 Hz to 15 kHz every 2 seconds
+    chirpPhase   += 2 * M_PI * sweep / sampleRate;
+    double  value = 3000 * sin(2 * M_PI * 110 * t) + 2000 * sin(2 * M_PI * 1250 * t) +
+                    4000 * sin(chirpPhase) + noise(random);
+    input[s] = (short)std::max(-32768.0, std::min(32767.0, value));
+  }
+
+  printf("%.0f Hz, %.1f s of audio, %llu frames of %d samples%s\n", sampleRate, seconds,
+         (unsigned long long)hops, PIPELINE_HOP, paced ? ", paced" : "");
+  PipelineConfig  config = visualEarPipeline(sampleRate);
+  for (int r = 0; r < PIPELINE_RANGES; r++) {
+    float  binHz = sampleRate / config.skip[r] / config.fftSamples[r];
+    printf("  range %d:  skip %2u, %7.1f Hz FFT, %u bands from %.0f Hz to %.0f Hz\n", r, config.skip[r],
+           sampleRate / config.skip[r], config.bands[r], config.bandBins[r][0] * binHz,
+           config.bandBins[r][config.bands[r]] * binHz);
+  }
+  printf("%-10s %10s %10s %12s %12s %12s %14s\n", "mode", "seconds", "frames/s", "x realtime", "mean lat us", "max lat us", "critical us");
+
+  uint64_t  checksum[2] = { 0, 0 };
+  for (int threaded = 0; threaded < 2; threaded++) {
+    PipelineExecutor  executor(config, threaded != 0);
+    uint64_t         &sum = checksum[threaded];
+
+    auto start = std::chrono::steady_clock::now();
+    executor.start([&](const PipelineFrame &frame) {
+      for (int b = 0; b < frame.bands; b++) {
+        sum = (sum * 31) + frame.values[b];
+      }
+    });
+    for (uint64_t h = 0; h < hops; h++) {
+      if (paced) {
+        std::this_thread::sleep_until(start + std::chrono::microseconds((int64_t)(h * PIPELINE_HOP * 1e6 / sampleRate)));
+      }
+      executor.push(&input[h * PIPELINE_HOP]);
+    }
+    executor.finish();
+    double  elapsed = secondsSince(start);
+
+    const PipelineStats &stats = executor.stats();
+    printf("%-10s %10.3f %10.0f %12.1f %12.1f %12.1f %14.1f\n", threaded ? "pipelined" : "serial", elapsed,
+           stats.frames / elapsed, seconds / elapsed,
+           stats.frames ? stats.latencySumUs / stats.frames : 0, stats.latencyMaxUs,
+           stats.frames ? stats.criticalSumUs / stats.frames : 0);
+  }
+
+  printf("band frames %s\n", (checksum[0] == checksum[1]) ? "match" : "DIFFER");
+  return (checksum[0] == checksum[1]) ? 0 : 1;
+}
+
+// ======================================================================================================
+
+int  main(int argc, char **argv) {
+  if ((argc == 4) && !strcmp(argv[1], "record")) {
+    return record(argv[2], argv[3]);
+  }
+  if ((argc == 3) && !strcmp(argv[1], "info")) {
+    return info(argv[2]);
+  }
+  if ((argc == 5) && !strcmp(argv[1], "max")) {
+    return rangeMax(argv[2], strtoull(argv[3], NULL, 0), strtoull(argv[4], NULL, 0));
+  }
+  if ((argc == 4) && !strcmp(argv[1], "bench")) {
+    return bench(argv[2], atof(argv[3]));
+  }
+  if (((argc == 4) || (argc == 5)) && !strcmp(argv[1], "pipeline")) {
+    return pipeline(atof(argv[2]), atof(argv[3]), (argc == 5) && !strcmp(argv[4], "paced"));
+  }
+
+  fprintf(stderr, "usage:  bandtool record <capture|tty|-> <out.rec>\n"
+                  "        bandtool info   <file.rec>\n"
+                  "        bandtool max    <file.rec> <fromMs> <toMs>\n"
+                  "        bandtool bench  <file.rec> <GB>\n"
+                  "        bandtool pipeline <sampleRate> <seconds> [paced]\n");
+  return 2;
+}
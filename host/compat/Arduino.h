@@ -0,0 +1,145 @@
+/*
+  Host stand-in for the parts of the Arduino core used by the device sources that are built into
+  the host tools unchanged (bufferManager, arduinoFFT_float, noiseTracker, ledOutput, ledLayout,
+  latencyTrace).  Add -Icompat to the host compile.
+
+  The clock starts at zero with the program.  Pin writes go to an optional hook instead of a pin,
+  so a host tool can watch what would be clocked out.  An IntervalTimer runs its interrupt on a
+  worker thread, holding the same lock that __disable_irq() takes, so interrupts are kept out of
+  the code that masks them, as on the device.
+*/
+
+#ifndef Arduino_h /* Prevent loading library twice */
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+typedef uint8_t         byte;
+typedef unsigned short  ushort;
+
+#define sq(x)           ((x) * (x))
+
+#define LOW             0
+#define HIGH            1
+#define INPUT           0
+#define OUTPUT          1
+
+using std::min;
+using std::max;
+
+// ======================================================================================================
+// Time
+// ======================================================================================================
+
+inline std::chrono::steady_clock::duration  hostUptime(void) {
+  static const std::chrono::steady_clock::time_point  start = std::chrono::steady_clock::now();
+  return std::chrono::steady_clock::now() - start;
+}
+
+inline uint32_t  micros(void) {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(hostUptime()).count();
+}
+
+inline uint32_t  millis(void) {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(hostUptime()).count();
+}
+
+inline void  delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void  delayMicroseconds(uint32_t us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// Bit timing only matters on a real pin
+inline void  delayNanoseconds(uint32_t ns) {}
+
+// ======================================================================================================
+// Pins
+// ======================================================================================================
+
+typedef void (*HostPinHook)(uint8_t pin, uint8_t level);
+
+inline HostPinHook  &hostPinHook(void) {
+  static HostPinHook  hook = 0;
+  return hook;
+}
+
+inline void  pinMode(uint8_t pin, uint8_t mode) {}
+
+inline void  digitalWriteFast(uint8_t pin, uint8_t level) {
+  if (hostPinHook()) {
+    hostPinHook()(pin, level);
+  }
+}
+
+// ======================================================================================================
+// Interrupts
+// ======================================================================================================
+
+// Never destroyed, so a timer thread still running at exit can't find it gone.
+inline std::recursive_mutex  &hostIrqLock(void) {
+  static std::recursive_mutex *lock = new std::recursive_mutex;
+  return *lock;
+}
+
+inline void __disable_irq(void) {
+  hostIrqLock().lock();
+}
+
+inline void __enable_irq(void) {
+  hostIrqLock().unlock();
+}
+
+// Calls the interrupt function every interval on a worker thread, until end().
+// end() may be called from the interrupt function itself.
+class IntervalTimer
+{
+public:
+  IntervalTimer() : _running(false) {}
+
+  ~IntervalTimer() {
+    end();
+  }
+
+  bool  begin(void (*isr)(void), uint32_t intervalUs) {
+    end();
+    _running = true;
+    _worker  = std::thread([this, isr, intervalUs]() {
+      std::chrono::steady_clock::time_point  next = std::chrono::steady_clock::now();
+      while (_running) {
+        next += std::chrono::microseconds(intervalUs);
+        std::this_thread::sleep_until(next);
+        std::lock_guard<std::recursive_mutex>  irq(hostIrqLock());
+        if (_running) {
+          isr();
+        }
+      }
+    });
+    return true;
+  }
+
+  void  end(void) {
+    _running = false;
+    if (_worker.joinable() && (_worker.get_id() != std::this_thread::get_id())) {
+      _worker.join();
+    }
+  }
+
+  void  priority(uint8_t level) {}
+
+private:
+  std::atomic<bool>  _running;
+  std::thread        _worker;
+};
+
+#endif
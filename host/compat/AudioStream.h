@@ -0,0 +1,9 @@
+/*
+  Host stand-in for the Teensy Audio library header.  Nothing from it is used by the analysis
+  sources that are built on the host.
+*/
+
+#ifndef AudioStream_h /* Prevent loading library twice */
+#define AudioStream_h
+
+#endif
@@ -0,0 +1,20 @@
+/*
+  Host stand-in for the FastLED header.  Only the CRGB pixel is used by the sources that are built
+  on the host.
+*/
+
+#ifndef FastLED_h /* Prevent loading library twice */
+#define FastLED_h
+
+#include <stdint.h>
+
+struct CRGB {
+  uint8_t   r;
+  uint8_t   g;
+  uint8_t   b;
+
+  CRGB() = default;
+  CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+};
+
+#endif
@@ -0,0 +1,9 @@
+/*
+  Host stand-in for the CMSIS DSP header.  Nothing from it is used by the analysis sources that
+  are built on the host.
+*/
+
+#ifndef _ARM_MATH_H /* Prevent loading library twice */
+#define _ARM_MATH_H
+
+#endif
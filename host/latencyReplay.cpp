@@ -0,0 +1,262 @@
+/*
+  Latency Replay (host side).
+
+  Replays audio to light latency traces through the device's latencyTrace code, with a simulated
+  clock installed by setLatencyClock().  Each traced frame is stamped again, stage by stage, with the
+  clock set to the time the stage was reached, and recorded, so the histogram comes out of the same
+  code as on the device.
+
+  latencyReplay capture <file>        Frames from the "Latency Trace" lines the Visual Ear prints
+                                      (reportLatency() in VisualEar.ino) in a serial capture.
+                                      The device's own histogram ("Latency Bins") is shown as well.
+  latencyReplay model [seconds] [computeUs] [bandsUs] [drawUs]
+                                      Frames from a model of the device's timing:  a block every
+                                      128 samples, an analysis frame every 4 blocks, renders at
+                                      RENDER_RATE_HZ and the LED output's transmit time.
+
+  Reported:  min, mean, 95th percentile and max of each stage and of the total, and the histogram.
+
+  g++ -std=c++11 -O2 -Icompat -o latencyReplay latencyReplay.cpp ../latencyTrace.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+#include <Arduino.h>
+#include "../devconf.h"
+#include "../latencyTrace.h"
+#include "../renderScheduler.h"
+#include "../ledOutput.h"
+
+#define SAMPLE_RATE     44100.0
+#define BLOCK_US        (128 * 1000000.0 / SAMPLE_RATE)
+#define FRAME_BLOCKS    4
+#define TX_US           (((LED_TX_BYTES(NUM_LEDS) + LED_TX_BURST_BYTES - 1) / LED_TX_BURST_BYTES) * LED_TX_INTERVAL_US)
+
+// ======================================================================================================
+// Simulated clock
+// ======================================================================================================
+
+static uint32_t  simUs = 0;
+
+static uint32_t  simClock(void) {
+  return simUs;
+}
+
+// Stamp a frame again as the device does, setting the clock to each stage's time, and record it.
+static void  replayFrame(const FrameStamp &traced) {
+  FrameStamp  stamp;
+
+  simUs = traced.blockUs;      stamp.blockUs    = latencyNow();
+  simUs = traced.analysedUs;   stamp.analysedUs = latencyNow();
+  simUs = traced.bandsUs;      stamp.bandsUs    = latencyNow();
+  simUs = traced.renderUs;     stamp.renderUs   = latencyNow();
+  simUs = traced.shownUs;      stamp.shownUs    = latencyNow();
+  stamp.valid = true;
+  recordLatency(stamp);
+}
+
+// ======================================================================================================
+// Sources
+// ======================================================================================================
+
+// Traced frames from a serial capture.  Overlapping dumps are only counted once.
+static bool  readCapture(const char *path, std::vector<FrameStamp> &frames, std::vector<uint32_t> &deviceBins, uint32_t &deviceFrames) {
+  FILE  *input = fopen(path, "r");
+  char   line[1024];
+  std::set<std::pair<uint32_t, uint32_t> > seen;
+
+  if (!input) {
+    return false;
+  }
+
+  while (fgets(line, sizeof(line), input)) {
+    const char  *trace = strstr(line, "Latency Trace ");
+    const char  *bins  = strstr(line, "Latency Bins ");
+    FrameStamp   frame;
+
+    if (trace && (sscanf(trace + 14, "%u %u %u %u %u", &frame.blockUs, &frame.analysedUs, &frame.bandsUs,
+                         &frame.renderUs, &frame.shownUs) == 5)) {
+      if (seen.insert(std::make_pair(frame.blockUs, frame.shownUs)).second) {
+        frame.valid = true;
+        frames.push_back(frame);
+      }
+    } else if (bins) {
+      // only a complete line, with the same bin width, replaces the last one
+      std::vector<uint32_t>  values;
+      char  *next = (char *)bins + 13;
+      char  *end;
+      while (true) {
+        uint32_t  value = strtoul(next, &end, 10);
+        if (end == next) {
+          break;
+        }
+        values.push_back(value);
+        next = end;
+      }
+      if ((values.size() == LATENCY_BINS + 2) && (values[1] == LATENCY_BIN_US)) {
+        deviceFrames = values[0];
+        deviceBins.assign(values.begin() + 2, values.end());
+      }
+    }
+  }
+  fclose(input);
+  return true;
+}
+
+// Traced frames from a model of the device's timing.  Renders happen on RENDER_INTERVAL_US slots and
+// carry the newest analysis frame the first time it is shown.  A render that finds a frame still held
+// by the LED output is skipped (renderDue()), otherwise it waits for the strip if it is busy.
+static void  modelFrames(double seconds, uint32_t computeUs, uint32_t bandsUs, uint32_t drawUs, std::vector<FrameStamp> &frames) {
+  double      endUs     = seconds * 1e6;
+  long        nextFrame = 0;
+  FrameStamp  newest;
+  FrameStamp  held;
+  bool        holding   = false;
+  double      ledFreeUs = 0;
+
+  memset(&newest, 0, sizeof(newest));
+  memset(&held, 0, sizeof(held));
+
+  for (double slotUs = 0; slotUs < endUs; slotUs += RENDER_INTERVAL_US) {
+    // analysis frames published since the last slot
+    while (true) {
+      double  blockUs = (nextFrame + 1) * FRAME_BLOCKS * BLOCK_US;
+      if (blockUs + computeUs + bandsUs > slotUs) {
+        break;
+      }
+      newest.blockUs    = (uint32_t)blockUs;
+      newest.analysedUs = (uint32_t)(blockUs + computeUs);
+      newest.bandsUs    = (uint32_t)(blockUs + computeUs + bandsUs);
+      newest.valid      = true;
+      nextFrame++;
+    }
+
+    // a held frame goes out as soon as the strip is free
+    if (holding && (ledFreeUs <= slotUs)) {
+      if (held.valid) {
+        held.shownUs = (uint32_t)(ledFreeUs + TX_US);
+        frames.push_back(held);
+      }
+      ledFreeUs += TX_US;
+      holding = false;
+    }
+    if (holding) {
+      continue;
+    }
+
+    FrameStamp  render = newest;
+    double      renderUs = slotUs + drawUs;
+    newest.valid    = false;
+    render.renderUs = (uint32_t)renderUs;
+
+    if (ledFreeUs <= renderUs) {
+      if (render.valid) {
+        render.shownUs = (uint32_t)(renderUs + TX_US);
+        frames.push_back(render);
+      }
+      ledFreeUs = renderUs + TX_US;
+    } else {
+      held    = render;
+      holding = true;
+    }
+  }
+}
+
+// ======================================================================================================
+// Report
+// ======================================================================================================
+
+static void  stageLine(const char *name, std::vector<uint32_t> values) {
+  double  sum = 0;
+
+  std::sort(values.begin(), values.end());
+  for (size_t i = 0; i < values.size(); i++) {
+    sum += values[i];
+  }
+  printf("  %-18s %8u %8.0f %8u %8u\n", name, values.front(), sum / values.size(),
+         values[(values.size() * 95) / 100], values.back());
+}
+
+static void  histogramLines(const char *name, const uint32_t *bins, uint32_t frames) {
+  uint32_t  most = *std::max_element(bins, bins + LATENCY_BINS);
+
+  printf("%s histogram, %u frames\n", name, frames);
+  for (int b = 0; b < LATENCY_BINS; b++) {
+    if (bins[b]) {
+      int   bar = (int)((50.0 * bins[b]) / most + 0.5);
+      printf("  %5.1f ms%s %7u  %.*s\n", (b * LATENCY_BIN_US) / 1000.0, (b == LATENCY_BINS - 1) ? "+" : " ",
+             bins[b], bar, "##################################################");
+    }
+  }
+}
+
+static void  report(const std::vector<FrameStamp> &frames) {
+  std::vector<uint32_t>  analyse, bands, render, show, total;
+  uint32_t  bins[LATENCY_BINS];
+
+  for (size_t f = 0; f < frames.size(); f++) {
+    analyse.push_back(frames[f].analysedUs - frames[f].blockUs);
+    bands.push_back(frames[f].bandsUs - frames[f].analysedUs);
+    render.push_back(frames[f].renderUs - frames[f].bandsUs);
+    show.push_back(frames[f].shownUs - frames[f].renderUs);
+    total.push_back(frames[f].shownUs - frames[f].blockUs);
+  }
+
+  printf("  %-18s %8s %8s %8s %8s   (uS)\n", "stage", "min", "mean", "95%", "max");
+  stageLine("block -> analysed", analyse);
+  stageLine("analysed -> bands", bands);
+  stageLine("bands -> render", render);
+  stageLine("render -> shown", show);
+  stageLine("block -> shown", total);
+
+  uint32_t  recorded = readLatencyHistogram(bins);
+  histogramLines("replayed", bins, recorded);
+}
+
+int  main(int argc, char **argv) {
+  std::vector<FrameStamp>  frames;
+  std::vector<uint32_t>    deviceBins;
+  uint32_t                 deviceFrames = 0;
+
+  if ((argc > 2) && !strcmp(argv[1], "capture")) {
+    if (!readCapture(argv[2], frames, deviceBins, deviceFrames)) {
+      fprintf(stderr, "can't open %s\n", argv[2]);
+      return 1;
+    }
+  } else if ((argc > 1) && !strcmp(argv[1], "model")) {
+    double    seconds   = (argc > 2) ? atof(argv[2]) : 10.0;
+    uint32_t  computeUs = (argc > 3) ? atol(argv[3]) : 1500;
+    uint32_t  bandsUs   = (argc > 4) ? atol(argv[4]) : 200;
+    uint32_t  drawUs    = (argc > 5) ? atol(argv[5]) : 200;
+    printf("model:  %.0f s, compute %u uS, bands %u uS, draw %u uS, renders every %u uS, LED transmit %u uS\n",
+           seconds, computeUs, bandsUs, drawUs, (uint32_t)RENDER_INTERVAL_US, (uint32_t)TX_US);
+    modelFrames(seconds, computeUs, bandsUs, drawUs, frames);
+  } else {
+    fprintf(stderr, "latencyReplay capture <file>\n"
+                    "latencyReplay model [seconds] [computeUs] [bandsUs] [drawUs]\n");
+    return 1;
+  }
+
+  if (frames.empty()) {
+    fprintf(stderr, "no traced frames\n");
+    return 1;
+  }
+
+  setLatencyClock(simClock);
+  resetLatency();
+  for (size_t f = 0; f < frames.size(); f++) {
+    replayFrame(frames[f]);
+  }
+
+  printf("%zu traced frames replayed\n", frames.size());
+  report(frames);
+  if (deviceBins.size() == LATENCY_BINS) {
+    histogramLines("device", deviceBins.data(), deviceFrames);
+  }
+  return 0;
+}
@@ -0,0 +1,162 @@
+/*
+  LED Output Tool (host side).
+
+  Runs the device's LED output stage (ledOutput, ledLayout) with the host IntervalTimer, whose
+  interrupt runs on a worker thread, and decodes the APA102 frames as they are clocked out of the
+  pins.  The main thread plays the part of loop():  it draws a frame, shows it, and then clears
+  leds[] straight away and spends renderUs "analysing" while calling serviceLEDOutput(), so the
+  next frame is always drawn while the last one is still going out.
+
+  Every pixel of frame f is drawn in the same colour, tagged with f, and each frame that arrives
+  at the strip is checked.  A frame that arrives with the wrong pixels (eg: the cleared leds[]),
+  or out of order, is counted as bad.  Frames that never arrive should match the dropped count.
+
+  ledtool <frames> [renderUs]
+
+  g++ -std=c++11 -O2 -pthread -Icompat -o ledtool ledtool.cpp \
+      ../ledOutput.cpp ../ledLayout.cpp ../latencyTrace.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <Arduino.h>
+#include "../devconf.h"
+#include "../ledOutput.h"
+
+#define TAG_BLUE      0x5A                          // Blue of every drawn pixel, so black can't pass
+
+// ======================================================================================================
+// Strip decoder.  Runs on the timer thread, from the pin writes.
+// ======================================================================================================
+
+struct StripDecoder {
+  uint8_t   data;                                   // Level of the data pin
+  uint8_t   shift;                                  // Bits shifted in so far
+  uint8_t   bits;
+  uint8_t   blue;                                   // Colour of the LED being decoded
+  uint8_t   green;
+  uint16_t  index;                                  // Byte number within the frame
+  uint16_t  frameBytes;
+  bool      good;                                   // Every pixel so far carries tag
+  long      tag;
+  long      lastTag;
+  uint32_t  frames;
+  uint32_t  badFrames;
+};
+
+StripDecoder  strips[NUM_LED_CHANNELS];
+
+static void  endStripFrame(StripDecoder &strip) {
+  strip.frames++;
+  if (!strip.good || (strip.tag <= strip.lastTag)) {
+    strip.badFrames++;
+  } else {
+    strip.lastTag = strip.tag;
+  }
+  strip.index = 0;
+  strip.good  = true;
+  strip.tag   = -1;
+}
+
+// One byte of an APA102 frame:  4 start bytes, then header, blue, green, red for each LED, then the end bytes.
+static void  stripByte(StripDecoder &strip, uint8_t value) {
+  uint16_t  index = strip.index++;
+  uint16_t  ledBytes = strip.frameBytes - LED_START_BYTES - LED_END_BYTES((strip.frameBytes - LED_START_BYTES) / 4);
+
+  if ((index >= LED_START_BYTES) && (index < LED_START_BYTES + ledBytes)) {
+    uint8_t   field = (index - LED_START_BYTES) % 4;
+
+    if (field == 0) {
+      strip.good = strip.good && (value == (0xE0 | LED_GLOBAL_BRIGHTNESS));
+    } else if (field == 1) {
+      strip.blue = value;
+    } else if (field == 2) {
+      strip.green = value;
+    } else {
+      long  tag = ((long)strip.green << 8) | value;
+      strip.good = strip.good && (strip.blue == TAG_BLUE) && ((strip.tag < 0) || (strip.tag == tag));
+      strip.tag  = tag;
+    }
+  }
+
+  if (strip.index == strip.frameBytes) {
+    endStripFrame(strip);
+  }
+}
+
+static void  pinWritten(uint8_t pin, uint8_t level) {
+  for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+    StripDecoder &strip = strips[ch];
+
+    if (pin == ledChannels[ch].dataPin) {
+      strip.data = level;
+    } else if ((pin == ledChannels[ch].clockPin) && (level == HIGH)) {
+      strip.shift = (strip.shift << 1) | strip.data;
+      if (++strip.bits == 8) {
+        stripByte(strip, strip.shift);
+        strip.bits = 0;
+      }
+    }
+  }
+}
+
+// ======================================================================================================
+
+// Frame f, in a colour that carries f (red and green) through the layout unchanged.
+static void  drawFrame(long f) {
+  for (int l = 0; l < NUM_LEDS; l++) {
+    leds[l] = CRGB(f & 0xFF, (f >> 8) & 0xFF, TAG_BLUE);
+  }
+}
+
+int  main(int argc, char **argv) {
+  long      frames   = (argc > 1) ? atol(argv[1]) : 0;
+  uint32_t  renderUs = (argc > 2) ? atol(argv[2]) : 0;
+
+  if (frames <= 0) {
+    fprintf(stderr, "ledtool <frames> [renderUs]\n");
+    return 1;
+  }
+
+  initLEDOutput();
+  for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+    memset(&strips[ch], 0, sizeof(strips[ch]));
+    strips[ch].frameBytes = LED_TX_BYTES(min(ledChannels[ch].numLEDs, (uint16_t)MAX_CHANNEL_LEDS));
+    strips[ch].good    = true;
+    strips[ch].tag     = -1;
+    strips[ch].lastTag = -1;
+  }
+  hostPinHook() = pinWritten;
+
+  uint32_t  startUs = micros();
+  for (long f = 0; f < frames; f++) {
+    drawFrame(f & 0xFFFF);
+    showLEDs();
+    clearLEDs();
+
+    uint32_t  renderStart = micros();
+    do {
+      serviceLEDOutput();
+    } while (micros() - renderStart < renderUs);
+  }
+  while (ledOutputBusy() || ledFramePending()) {
+    serviceLEDOutput();
+  }
+  uint32_t  elapsedUs = micros() - startUs;
+
+  __disable_irq();
+  printf("%ld frames shown in %.1f ms, %u sent, %u dropped (%.0f frames/s)\n", frames, elapsedUs / 1000.0,
+         ledFramesSent(), ledFramesDropped(), ledFramesSent() * 1e6 / elapsedUs);
+  for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+    printf("channel %d:  %u frames received, %u bad\n", ch, strips[ch].frames, strips[ch].badFrames);
+  }
+  bool  ok = true;
+  for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+    ok = ok && (strips[ch].badFrames == 0) && (strips[ch].frames == ledFramesSent()) &&
+         (strips[ch].frames + ledFramesDropped() == (uint32_t)frames);
+  }
+  __enable_irq();
+
+  printf("%s\n", ok ? "ok" : "MISMATCH");
+  return ok ? 0 : 1;
+}
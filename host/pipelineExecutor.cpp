@@ -0,0 +1,252 @@
+/*
+  Pipelined Analysis Executor (host side).
+  See pipelineExecutor.h
+*/
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include "../devconf.h"
+#include "../bandMapper.h"
+#include "pipelineExecutor.h"
+
+static const uint16_t LO_bandBins[NUM_LO_BANDS + 1] = LO_BAND_BINS;
+static const uint16_t MD_bandBins[NUM_MD_BANDS + 1] = MD_BAND_BINS;
+static const uint16_t HI_bandBins[NUM_HI_BANDS + 1] = HI_BAND_BINS;
+
+static int64_t  nowNs(void) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The Visual Ear ranges and bands (see devconf.h and audioAnalyzer.h) at any sample rate.
+// Each skip is scaled so the range's FFT sample rate stays near the device's, then each band edge
+// is moved to the bin nearest its frequency on the device, so every band covers the same Hz.
+PipelineConfig  visualEarPipeline(float sampleRate) {
+  PipelineConfig  config;
+  const float     deviceRate = 44100.0;
+  const uint16_t  skip[PIPELINE_RANGES]  = { 16, 8, 1 };
+  const uint16_t  bands[PIPELINE_RANGES] = { NUM_LO_BANDS, NUM_MD_BANDS, NUM_HI_BANDS };
+  const uint16_t *bandBins[PIPELINE_RANGES] = { LO_bandBins, MD_bandBins, HI_bandBins };
+
+  memset(&config, 0, sizeof(config));
+  config.sampleRate   = sampleRate;
+  config.inputScale   = 0.01;
+  config.noiseMinimum = 40;
+  for (int r = 0; r < PIPELINE_RANGES; r++) {
+    config.skip[r]       = std::max(1, (int)lround(skip[r] * sampleRate / deviceRate));
+    config.fftSamples[r] = 1024;
+    config.bands[r]      = bands[r];
+
+    // device bin width / our bin width
+    float  binScale = (deviceRate / skip[r]) / (sampleRate / config.skip[r]);
+    int    lastBin  = (config.fftSamples[r] >> 1) - 1;
+    for (int b = 0; b <= bands[r]; b++) {
+      int  bin = std::min((int)lround(bandBins[r][b] * binScale), lastBin);
+      config.bandBins[r][b] = (b > 0) ? std::max(bin, (int)config.bandBins[r][b - 1]) : bin;
+    }
+  }
+  return config;
+}
+
+// ======================================================================================================
+// One range
+// ======================================================================================================
+
+RangeAnalysis::RangeAnalysis(uint16_t skip, uint16_t fftSamples, float sampleRate, float noiseMinimum) {
+  memset(_short, 0, sizeof(_short));
+  _FFT    = arduinoFFT_float(_vReal, _vImag, _weights, fftSamples, sampleRate / skip, FFT_WIN_TYP_HAMMING);
+  _buffer = BufferManager(_vReal, _weights, _short, fftSamples, skip);
+  _noise  = NoiseTracker(_vReal, _smooth, _threshold, fftSamples >> 1);
+  _noise.setMinimum(noiseMinimum);
+}
+
+// Add one hop of samples, then transform the latest window.  The same steps as AudioAnalyzeFFT::update().
+void  RangeAnalysis::process(const short *samples, float inputScale) {
+  for (int s = 0; s < PIPELINE_HOP; s++) {
+    _buffer.addSample(samples[s]);
+  }
+  _buffer.transfer(inputScale);
+  _FFT.RunFFT();
+  _noise.update();
+}
+
+const float *RangeAnalysis::magnitudes(void) const {
+  return _vReal;
+}
+
+const float *RangeAnalysis::thresholds(void) const {
+  return _threshold;
+}
+
+// ======================================================================================================
+// Executor
+// ======================================================================================================
+
+PipelineExecutor::PipelineExecutor(const PipelineConfig &config, bool threaded) {
+  _config   = config;
+  _threaded = threaded;
+  _running  = false;
+  _frame    = 0;
+  memset(&_stats, 0, sizeof(_stats));
+
+  for (int r = 0; r < PIPELINE_RANGES; r++) {
+    _range[r].reset(new RangeAnalysis(config.skip[r], config.fftSamples[r], config.sampleRate, config.noiseMinimum));
+    _input[r].reset(new SpscQueue<HopBlock>(PIPELINE_QUEUE));
+    _results[r].reset(new SpscQueue<RangeResult>(PIPELINE_QUEUE));
+  }
+}
+
+PipelineExecutor::~PipelineExecutor() {
+  finish();
+}
+
+void  PipelineExecutor::start(const FrameHandler &onFrame) {
+  finish();
+  _onFrame = onFrame;
+  _running = true;
+  _frame   = 0;
+  memset(&_stats, 0, sizeof(_stats));
+
+  if (_threaded) {
+    for (int r = 0; r < PIPELINE_RANGES; r++) {
+      _threads.push_back(std::thread(&PipelineExecutor::rangeStage, this, r));
+    }
+    _threads.push_back(std::thread(&PipelineExecutor::mapStage, this));
+  }
+}
+
+// Add one hop (PIPELINE_HOP samples).  Waits while the pipeline is full.
+void  PipelineExecutor::push(const short *samples) {
+  int64_t  pushNs = nowNs();
+
+  if (!_running) {
+    return;
+  }
+
+  if (!_threaded) {
+    const float *mag[PIPELINE_RANGES];
+    const float *threshold[PIPELINE_RANGES];
+    int64_t      slowestNs = 0;
+    for (int r = 0; r < PIPELINE_RANGES; r++) {
+      int64_t  startNs = nowNs();
+      _range[r]->process(samples, _config.inputScale);
+      slowestNs    = std::max(slowestNs, nowNs() - startNs);
+      mag[r]       = _range[r]->magnitudes();
+      threshold[r] = _range[r]->thresholds();
+    }
+    mapFrame(_frame++, pushNs, slowestNs, mag, threshold);
+    return;
+  }
+
+  HopBlock  block;
+  block.frame  = _frame++;
+  block.pushNs = pushNs;
+  block.last   = false;
+  memcpy(block.samples, samples, sizeof(block.samples));
+
+  for (int r = 0; r < PIPELINE_RANGES; r++) {
+    if (!_input[r]->pushWait(block)) {
+      _stats.fullWaits++;
+    }
+  }
+}
+
+// Let every frame pushed so far come out of the pipeline, then stop the threads.
+void  PipelineExecutor::finish(void) {
+  if (!_running) {
+    return;
+  }
+
+  if (_threaded) {
+    HopBlock  last;
+    memset(&last, 0, sizeof(last));
+    last.last = true;
+    for (int r = 0; r < PIPELINE_RANGES; r++) {
+      _input[r]->pushWait(last);
+    }
+    for (size_t t = 0; t < _threads.size(); t++) {
+      _threads[t].join();
+    }
+    _threads.clear();
+  }
+  _running = false;
+}
+
+const PipelineStats &PipelineExecutor::stats(void) const {
+  return _stats;
+}
+
+// Range thread:  transform each hop and pass the bins on to the map stage.
+void  PipelineExecutor::rangeStage(int range) {
+  HopBlock    block;
+  RangeResult result;
+  uint16_t    bins = _config.fftSamples[range] >> 1;
+
+  while (true) {
+    _input[range]->popWait(block);
+
+    result.frame  = block.frame;
+    result.pushNs = block.pushNs;
+    result.last   = block.last;
+    if (!block.last) {
+      int64_t  startNs = nowNs();
+      _range[range]->process(block.samples, _config.inputScale);
+      result.processNs = nowNs() - startNs;
+      memcpy(result.mag,       _range[range]->magnitudes(), bins * sizeof(float));
+      memcpy(result.threshold, _range[range]->thresholds(), bins * sizeof(float));
+    }
+
+    _results[range]->pushWait(result);
+    if (block.last) {
+      return;
+    }
+  }
+}
+
+// Map thread:  collect the ranges of each frame, in order, and map them to bands.
+void  PipelineExecutor::mapStage(void) {
+  std::unique_ptr<RangeResult[]> results(new RangeResult[PIPELINE_RANGES]);
+  const float *mag[PIPELINE_RANGES];
+  const float *threshold[PIPELINE_RANGES];
+
+  while (true) {
+    bool     last = false;
+    int64_t  slowestNs = 0;
+    for (int r = 0; r < PIPELINE_RANGES; r++) {
+      _results[r]->popWait(results[r]);
+      last = last || results[r].last;
+      mag[r]       = results[r].mag;
+      threshold[r] = results[r].threshold;
+      slowestNs    = std::max(slowestNs, results[r].processNs);
+    }
+    if (last) {
+      return;
+    }
+    mapFrame(results[0].frame, results[0].pushNs, slowestNs, mag, threshold);
+  }
+}
+
+void  PipelineExecutor::mapFrame(uint64_t frame, int64_t pushNs, int64_t slowestNs, const float *const *mag, const float *const *threshold) {
+  uint16_t  band = 0;
+  int64_t   mapStartNs = nowNs();
+
+  for (int r = 0; r < PIPELINE_RANGES; r++) {
+    mapBands(mag[r], threshold[r], _config.bandBins[r], _config.bands[r], _output.values + band);
+    band += _config.bands[r];
+  }
+  _output.frame     = frame;
+  _output.bands     = band;
+  _output.latencyUs = (nowNs() - pushNs) / 1000.0;
+  _stats.criticalSumUs += (slowestNs + (nowNs() - mapStartNs)) / 1000.0;
+
+  if (_onFrame) {
+    _onFrame(_output);
+  }
+
+  _stats.frames++;
+  _stats.latencySumUs += _output.latencyUs;
+  if (_output.latencyUs > _stats.latencyMaxUs) {
+    _stats.latencyMaxUs = _output.latencyUs;
+  }
+}
@@ -0,0 +1,145 @@
+/*
+  Pipelined Analysis Executor (host side).
+
+  Runs the Visual Ear analysis chain (BufferManager -> arduinoFFT_float -> NoiseTracker -> band
+  mapping) on a host, for streams faster than the device can handle (eg: 192 kHz) and for offline
+  processing.  The analysis sources are built unchanged, with compat/ standing in for the Arduino
+  headers.
+
+  Each hop of input samples goes through two stages:
+    range stage     one thread per range (LO, MD, HI):  buffer, transfer, FFT, noise floor
+    map stage       one thread:  waits for all ranges of a frame, maps bins to bands, calls the handler
+  Stages are joined by bounded lock free queues, so the three transforms of a frame run at the same
+  time, and frame N is mapped and rendered while frame N+1 is being transformed.  push() waits while
+  the queues are full, which keeps memory bounded and lets the caller see the sustained rate.
+  A stage with nothing to do spins briefly, then parks until its queue has work (see spscQueue.h),
+  so idle stages don't take cores from the busy ones.
+
+  The ranges and bands are the device's, scaled to the sample rate (visualEarPipeline()):  the
+  skips keep each range's FFT sample rate near the device's, and the band edges are moved to the
+  bins nearest the device's band frequencies.
+
+  With threaded == false everything runs inline in push(), for comparison.
+
+  C++11 with threads, eg:  g++ -std=c++11 -O2 -pthread -Icompat -c pipelineExecutor.cpp
+*/
+
+#ifndef pipelineExecutor_h /* Prevent loading library twice */
+#define pipelineExecutor_h
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "spscQueue.h"
+#include "../arduinoFFT_float.h"
+#include "../bufferManager.h"
+#include "../noiseTracker.h"
+
+#define PIPELINE_RANGES       3
+#define PIPELINE_HOP        512                   // Input samples per frame (4 blocks of 128)
+#define PIPELINE_MAX_FFT   1024
+#define PIPELINE_MAX_BANDS  255
+#define PIPELINE_QUEUE        8                   // Frames that can be in flight between two stages
+
+struct PipelineConfig {
+  float     sampleRate;
+  uint16_t  skip[PIPELINE_RANGES];                // Input samples combined into one FFT sample
+  uint16_t  fftSamples[PIPELINE_RANGES];
+  uint16_t  bands[PIPELINE_RANGES];               // Bands from each range
+  uint16_t  bandBins[PIPELINE_RANGES][PIPELINE_MAX_BANDS + 1];  // First bin of each band, and one past the last
+  float     inputScale;
+  float     noiseMinimum;                         // Lowest noise threshold of any bin
+};
+
+struct PipelineFrame {
+  uint64_t  frame;
+  uint16_t  bands;
+  uint32_t  values[PIPELINE_MAX_BANDS];
+  double    latencyUs;                            // From push() of the hop to the handler
+};
+
+struct PipelineStats {
+  uint64_t  frames;
+  double    latencySumUs;
+  double    latencyMaxUs;
+  uint64_t  fullWaits;                            // Times push() found the range queues full
+  double    criticalSumUs;                        // Slowest range plus mapping, per frame:  the latency
+                                                  // with a core for every stage and no hand offs
+};
+
+// The analysis state of one range.  Holds pointers into itself, so it is never copied.
+class RangeAnalysis
+{
+public:
+  RangeAnalysis(uint16_t skip, uint16_t fftSamples, float sampleRate, float noiseMinimum);
+  void  process(const short *samples, float inputScale);
+  const float *magnitudes(void) const;
+  const float *thresholds(void) const;
+
+private:
+  RangeAnalysis(const RangeAnalysis &);
+  RangeAnalysis &operator=(const RangeAnalysis &);
+
+  short     _short[PIPELINE_MAX_FFT];
+  float     _vReal[PIPELINE_MAX_FFT];
+  float     _vImag[PIPELINE_MAX_FFT];
+  float     _weights[PIPELINE_MAX_FFT];
+  float     _smooth[PIPELINE_MAX_FFT / 2];
+  float     _threshold[PIPELINE_MAX_FFT / 2];
+  arduinoFFT_float  _FFT;
+  BufferManager     _buffer;
+  NoiseTracker      _noise;
+};
+
+class PipelineExecutor
+{
+public:
+  typedef std::function<void(const PipelineFrame &frame)> FrameHandler;
+
+  PipelineExecutor(const PipelineConfig &config, bool threaded);
+  ~PipelineExecutor();
+  void  start(const FrameHandler &onFrame);
+  void  push(const short *samples);
+  void  finish(void);
+  const PipelineStats &stats(void) const;
+
+private:
+  struct HopBlock {
+    uint64_t  frame;
+    int64_t   pushNs;
+    bool      last;
+    short     samples[PIPELINE_HOP];
+  };
+
+  struct RangeResult {
+    uint64_t  frame;
+    int64_t   pushNs;
+    bool      last;
+    int64_t   processNs;
+    float     mag[PIPELINE_MAX_FFT / 2];
+    float     threshold[PIPELINE_MAX_FFT / 2];
+  };
+
+  void  rangeStage(int range);
+  void  mapStage(void);
+  void  mapFrame(uint64_t frame, int64_t pushNs, int64_t slowestNs, const float *const *mag, const float *const *threshold);
+
+  PipelineConfig  _config;
+  bool            _threaded;
+  bool            _running;
+  FrameHandler    _onFrame;
+  PipelineStats   _stats;
+  uint64_t        _frame;
+  PipelineFrame   _output;
+  std::unique_ptr<RangeAnalysis>          _range[PIPELINE_RANGES];
+  std::unique_ptr<SpscQueue<HopBlock> >   _input[PIPELINE_RANGES];
+  std::unique_ptr<SpscQueue<RangeResult> > _results[PIPELINE_RANGES];
+  std::vector<std::thread>                _threads;
+};
+
+PipelineConfig  visualEarPipeline(float sampleRate);
+
+#endif
@@ -0,0 +1,150 @@
+/*
+  Bounded single producer, single consumer queue (host side).
+
+  Lock free:  the producer only writes the tail and the consumer only writes the head, so one
+  thread can push while another pops without either of them waiting on a lock.  Items are copied
+  in and out of a fixed ring, nothing is allocated after construction.
+
+  pushWait() and popWait() spin for SPSC_SPIN_TRIES tries, then park the thread on a condition
+  variable until the other side makes room or adds an item.  The other side only takes the lock
+  to wake a thread that is actually parked, so a busy queue stays lock free.
+
+  Standard C++11 only.
+*/
+
+#ifndef spscQueue_h /* Prevent loading library twice */
+#define spscQueue_h
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#define SPSC_SPIN_TRIES   2000                // Tries before a waiting thread parks (a few uS)
+
+template <typename T>
+class SpscQueue
+{
+public:
+  // capacity is rounded up to a power of 2
+  explicit SpscQueue(size_t capacity) {
+    size_t  size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    _ring.resize(size);
+    _mask = size - 1;
+    _head.store(0);
+    _tail.store(0);
+    _pushParked.store(false);
+    _popParked.store(false);
+  }
+
+  // Producer.  Returns false if the queue is full.
+  bool  push(const T &item) {
+    if (!tryPush(item)) {
+      return false;
+    }
+    wake(_popParked);
+    return true;
+  }
+
+  // Consumer.  Returns false if the queue is empty.
+  bool  pop(T &item) {
+    if (!tryPop(item)) {
+      return false;
+    }
+    wake(_pushParked);
+    return true;
+  }
+
+  // Producer.  Waits while the queue is full.  Returns false if it had to wait.
+  bool  pushWait(const T &item) {
+    if (push(item)) {
+      return true;
+    }
+    waitFor(_pushParked, [&]() { return tryPush(item); });
+    wake(_popParked);
+    return false;
+  }
+
+  // Consumer.  Waits while the queue is empty.
+  void  popWait(T &item) {
+    if (!pop(item)) {
+      waitFor(_popParked, [&]() { return tryPop(item); });
+      wake(_pushParked);
+    }
+  }
+
+  size_t  capacity(void) const {
+    return _mask + 1;
+  }
+
+private:
+  bool  tryPush(const T &item) {
+    size_t  tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) > _mask) {
+      return false;
+    }
+    _ring[tail & _mask] = item;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool  tryPop(T &item) {
+    size_t  head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = _ring[head & _mask];
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Spin on tryOnce(), then park until the other side wakes us.  parked is set before the last
+  // try, and the other side checks it after moving its index, with a fence between each store and
+  // load, so one of them always sees the other.
+  template <typename Try>
+  void  waitFor(std::atomic<bool> &parked, Try tryOnce) {
+    for (int i = 0; i < SPSC_SPIN_TRIES; i++) {
+      if (tryOnce()) {
+        return;
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(_lock);
+    while (true) {
+      parked.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (tryOnce()) {
+        break;
+      }
+      _wake.wait(lock);
+    }
+    parked.store(false, std::memory_order_relaxed);
+  }
+
+  void  wake(std::atomic<bool> &parked) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(_lock);
+      _wake.notify_all();
+    }
+  }
+
+  // head and tail are kept on separate cache lines so the two threads don't fight over one line
+  std::vector<T>  _ring;
+  size_t          _mask;
+  char            _pad0[64];
+  std::atomic<size_t> _head;                  // Next item to pop.  Written by the consumer only.
+  char            _pad1[64];
+  std::atomic<size_t> _tail;                  // Next free slot.  Written by the producer only.
+  char            _pad2[64];
+  std::atomic<bool> _pushParked;              // The producer is (about to be) waiting on _wake
+  std::atomic<bool> _popParked;               // The consumer is (about to be) waiting on _wake
+  std::mutex      _lock;
+  std::condition_variable _wake;
+};
+
+#endif
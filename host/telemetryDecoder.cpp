@@ -0,0 +1,155 @@
+/*
+  Band Frame Telemetry Decoder (host side).
+  See telemetryDecoder.h
+*/
+
+#include <string.h>
+#include "telemetryDecoder.h"
+
+// Constructor
+TelemetryDecoder::TelemetryDecoder() {
+  reset();
+}
+
+void  TelemetryDecoder::reset(void) {
+  _buffer.clear();
+  memset(&_frame, 0, sizeof(_frame));
+  memset(&_stats, 0, sizeof(_stats));
+  _haveReference = false;
+  _haveSequence  = false;
+  _lastSequence  = 0;
+  _atFrame       = false;
+}
+
+const TelemetryStats &TelemetryDecoder::stats(void) const {
+  return _stats;
+}
+
+// Add received bytes, and hand every complete frame to onFrame.
+void  TelemetryDecoder::feed(const uint8_t *data, size_t length, const FrameHandler &onFrame) {
+  size_t  start = 0;
+
+  _buffer.insert(_buffer.end(), data, data + length);
+
+  while (_buffer.size() - start >= 2) {
+    const uint8_t *frame = _buffer.data() + start;
+    size_t  available = _buffer.size() - start;
+
+    // hunt for the sync bytes
+    if ((frame[0] != TELEMETRY_SYNC0) || (frame[1] != TELEMETRY_SYNC1)) {
+      badFrame();
+      start++;
+      continue;
+    }
+    if (available < TELEMETRY_HEADER_BYTES) {
+      break;
+    }
+
+    uint8_t   bands   = frame[3];
+    uint16_t  payload = frame[10] | (frame[11] << 8);
+    uint16_t  total   = TELEMETRY_HEADER_BYTES + payload + TELEMETRY_CRC_BYTES;
+
+    if ((bands == 0) || (payload > TELEMETRY_MAX_PAYLOAD(bands)) ||
+        ((frame[2] != TELEMETRY_KEY) && (frame[2] != TELEMETRY_DELTA))) {
+      badFrame();
+      start++;
+      continue;
+    }
+    if (available < total) {
+      break;
+    }
+
+    uint16_t  crc = frame[total - 2] | (frame[total - 1] << 8);
+    if (crc != telemetryCRC(frame + 2, total - 4)) {
+      // not a real frame, or a damaged one.  Either way keep hunting from the next byte.
+      badFrame();
+      start++;
+      continue;
+    }
+
+    if (decodeFrame(frame, total)) {
+      onFrame(_frame);
+    }
+    _atFrame = true;
+    start += total;
+  }
+
+  _buffer.erase(_buffer.begin(), _buffer.begin() + start);
+}
+
+// Nothing valid where a frame should start.  Only counted where the last good frame ended:  while
+// hunting for sync, false syncs in the data are not damaged frames.
+void  TelemetryDecoder::badFrame(void) {
+  if (_atFrame) {
+    _stats.crcErrors++;
+    _atFrame = false;
+  }
+}
+
+// Rebuild the band values of one CRC checked frame.  Returns false if it can't be rebuilt.
+bool  TelemetryDecoder::decodeFrame(const uint8_t *frame, uint16_t length) {
+  bool      key      = (frame[2] == TELEMETRY_KEY);
+  uint8_t   bands    = frame[3];
+  uint16_t  sequence = frame[4] | (frame[5] << 8);
+  uint32_t  timeMs   = frame[6] | (frame[7] << 8) | (frame[8] << 16) | ((uint32_t)frame[9] << 24);
+  const uint8_t *src = frame + TELEMETRY_HEADER_BYTES;
+  uint32_t  left     = length - TELEMETRY_HEADER_BYTES - TELEMETRY_CRC_BYTES;
+  uint32_t  values[TELEMETRY_MAX_BANDS];
+  int       band     = 0;
+
+  // the sequence is followed across resyncs and skipped frames, so every gap is counted
+  if (_haveSequence && (sequence != (uint16_t)(_lastSequence + 1))) {
+    _stats.lostFrames += (uint16_t)(sequence - _lastSequence - 1);
+    _haveReference = false;
+  }
+  _lastSequence = sequence;
+  _haveSequence = true;
+
+  if (!key && (!_haveReference || (bands != _frame.bands))) {
+    _stats.skippedFrames++;
+    return false;
+  }
+
+  while (band < bands) {
+    uint32_t  token;
+    int       used = varintDecode(src, left, &token);
+
+    if (used == 0) {
+      _haveReference = false;
+      return false;
+    }
+    src  += used;
+    left -= used;
+
+    uint32_t  delta = (uint32_t)zigzagDecode(token);
+    values[band] = (key ? 0 : _frame.values[band]) + delta;
+    band++;
+
+    // a zero is followed by the number of extra zeros
+    if (delta == 0) {
+      if (left == 0) {
+        _haveReference = false;
+        return false;
+      }
+      uint8_t  zeros = *src++;
+      left--;
+      while ((zeros-- > 0) && (band < bands)) {
+        values[band] = key ? 0 : _frame.values[band];
+        band++;
+      }
+    }
+  }
+
+  memcpy(_frame.values, values, bands * sizeof(uint32_t));
+  _frame.sequence = sequence;
+  _frame.timeMs   = timeMs;
+  _frame.bands    = bands;
+  _frame.key      = key;
+  _haveReference  = true;
+
+  _stats.frames++;
+  if (key) {
+    _stats.keyFrames++;
+  }
+  return true;
+}
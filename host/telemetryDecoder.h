@@ -0,0 +1,63 @@
+/*
+  Band Frame Telemetry Decoder (host side).
+
+  Rebuilds the band frames streamed by the Visual Ear (see ../telemetryFormat.h) from the raw bytes
+  read off its serial port.  Bytes can be fed in any sized pieces; every complete, CRC checked frame
+  is handed to the callback with its full band values.
+
+  Delta frames can only be rebuilt on top of the frame before them, so after a sequence gap the
+  decoder skips frames until the next KEY frame arrives.  A damaged frame shows up as a gap in the
+  sequence.  The frames lost are counted from the gap, across any resync.
+
+  Standard C++11 only, eg:  g++ -std=c++11 -O2 -c telemetryDecoder.cpp
+*/
+
+#ifndef telemetryDecoder_h /* Prevent loading library twice */
+#define telemetryDecoder_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+#include "../telemetryFormat.h"
+
+struct BandFrame {
+  uint16_t  sequence;
+  uint32_t  timeMs;
+  uint8_t   bands;
+  bool      key;
+  uint32_t  values[TELEMETRY_MAX_BANDS];
+};
+
+struct TelemetryStats {
+  uint32_t  frames;             // Frames rebuilt
+  uint32_t  keyFrames;          // ... of which were KEY frames
+  uint32_t  crcErrors;          // Damaged frames:  nothing valid where the last good frame ended
+  uint32_t  lostFrames;         // Frames missing from the sequence
+  uint32_t  skippedFrames;      // Delta frames skipped while waiting for a KEY frame
+};
+
+class TelemetryDecoder
+{
+public:
+  typedef std::function<void(const BandFrame &frame)> FrameHandler;
+
+  TelemetryDecoder();
+  void  reset(void);
+  void  feed(const uint8_t *data, size_t length, const FrameHandler &onFrame);
+  const TelemetryStats &stats(void) const;
+
+private:
+  bool  decodeFrame(const uint8_t *frame, uint16_t length);
+  void  badFrame(void);
+
+  std::vector<uint8_t> _buffer;
+  BandFrame       _frame;
+  TelemetryStats  _stats;
+  bool            _haveReference;
+  bool            _haveSequence;
+  uint16_t        _lastSequence;        // Of the last CRC checked frame, rebuilt or not
+  bool            _atFrame;             // The buffer starts where the last good frame ended
+};
+
+#endif
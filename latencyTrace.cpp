@@ -0,0 +1,80 @@
+/*
+  Audio to Light Latency Tracing.
+  See latencyTrace.h
+*/
+
+#include <Arduino.h>
+#include "latencyTrace.h"
+
+// ======================================================================================================
+
+LatencyClock        latencyClock = micros;
+
+volatile uint32_t   latencyBins[LATENCY_BINS];
+volatile uint32_t   latencyFrames = 0;
+FrameStamp          traceFrames[LATENCY_TRACE_FRAMES];
+volatile uint16_t   traceNext = 0;
+
+// ======================================================================================================
+
+void  setLatencyClock(LatencyClock clock) {
+  latencyClock = clock ? clock : micros;
+}
+
+uint32_t  latencyNow() {
+  return (latencyClock());
+}
+
+void  resetLatency() {
+  __disable_irq();
+  memset((void *)latencyBins, 0, sizeof(latencyBins));
+  memset(traceFrames, 0, sizeof(traceFrames));
+  latencyFrames = 0;
+  traceNext = 0;
+  __enable_irq();
+}
+
+// Add a completed frame to the histogram and the trace.  Called from the LED output interrupt.
+void  recordLatency(const FrameStamp &stamp) {
+  uint32_t  bin = (stamp.shownUs - stamp.blockUs) / LATENCY_BIN_US;
+
+  if (bin >= LATENCY_BINS) {
+    bin = LATENCY_BINS - 1;
+  }
+  latencyBins[bin]++;
+  latencyFrames++;
+
+  traceFrames[traceNext] = stamp;
+  traceNext = (traceNext + 1) % LATENCY_TRACE_FRAMES;
+}
+
+// Copy out the histogram and return the number of frames it holds.
+uint32_t  readLatencyHistogram(uint32_t *bins) {
+  uint32_t  frames;
+
+  __disable_irq();
+  memcpy(bins, (const void *)latencyBins, sizeof(latencyBins));
+  frames = latencyFrames;
+  __enable_irq();
+
+  return (frames);
+}
+
+// Copy out the most recent traced frames, oldest first, and return how many were copied.
+int  readLatencyTrace(FrameStamp *frames, int maxFrames) {
+  int   count;
+  int   from;
+
+  __disable_irq();
+  count = (latencyFrames < LATENCY_TRACE_FRAMES) ? latencyFrames : LATENCY_TRACE_FRAMES;
+  if (count > maxFrames) {
+    count = maxFrames;
+  }
+  from = (traceNext + LATENCY_TRACE_FRAMES - count) % LATENCY_TRACE_FRAMES;
+  for (int f = 0; f < count; f++) {
+    frames[f] = traceFrames[(from + f) % LATENCY_TRACE_FRAMES];
+  }
+  __enable_irq();
+
+  return (count);
+}
@@ -0,0 +1,41 @@
+/*
+  Audio to Light Latency Tracing.
+
+  Each audio block is stamped as it arrives in AudioAnalyzeFFT::update().  The stamp of the newest
+  block in an analysis frame travels with that frame through fillBands(), the render scheduler and
+  the LED output, and is closed off when the last byte of the LED frame has been clocked out.
+
+  Completed frames go into a latency histogram and a short trace buffer holding every stage time.
+  All times come from latencyNow(), which reads micros() unless another clock has been installed
+  with setLatencyClock() (eg: a simulated clock when replaying a trace).
+*/
+
+#ifndef latencyTrace_h /* Prevent loading library twice */
+#define latencyTrace_h
+
+#include <Arduino.h>
+
+#define LATENCY_BIN_US        500                 // Width of each histogram bin
+#define LATENCY_BINS           64                 // Number of histogram bins (last one catches everything longer)
+#define LATENCY_TRACE_FRAMES   64                 // Number of frames kept in the trace buffer
+
+struct FrameStamp {
+  uint32_t  blockUs;              // Newest audio block arrived
+  uint32_t  analysedUs;           // FFTs complete
+  uint32_t  bandsUs;              // Bands filled
+  uint32_t  renderUs;             // Frame handed to the LED output
+  uint32_t  shownUs;              // Last LED byte clocked out
+  bool      valid;
+};
+
+typedef uint32_t (*LatencyClock)(void);
+
+void      setLatencyClock(LatencyClock clock);
+uint32_t  latencyNow();
+
+void      resetLatency();
+void      recordLatency(const FrameStamp &stamp);
+uint32_t  readLatencyHistogram(uint32_t *bins);
+int       readLatencyTrace(FrameStamp *frames, int maxFrames);
+
+#endif
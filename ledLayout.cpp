@@ -0,0 +1,142 @@
+/*
+  LED Layout.
+  See ledLayout.h
+*/
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "ledLayout.h"
+
+// ======================================================================================================
+
+const LedChannel ledChannels[NUM_LED_CHANNELS] = LED_CHANNELS;
+const LedSegment ledSegments[NUM_LED_SEGMENTS] = LED_SEGMENTS;
+
+// Source of each physical LED as a logical frame position in 8.8 fixed point.
+uint16_t  pixelSource[NUM_LED_CHANNELS][MAX_CHANNEL_LEDS];
+
+// Extra logical pixels each physical LED covers, when a segment has fewer LEDs than bands.
+// The LED shows the brightest of them, so no band is skipped.  0 to blend as usual.
+uint8_t   pixelRun[NUM_LED_CHANNELS][MAX_CHANNEL_LEDS];
+
+// ======================================================================================================
+
+// Work out where every LED of every segment gets its colour from.
+// A segment runs from firstBand up to lastBand.  Use mirror for a reversed run:  a segment with
+// lastBand below firstBand is left dark.
+void  initLEDLayout() {
+  memset(pixelSource, 0xFF, sizeof(pixelSource));
+  memset(pixelRun, 0, sizeof(pixelRun));
+
+  for (int s = 0; s < NUM_LED_SEGMENTS; s++) {
+    const LedSegment &seg = ledSegments[s];
+    if ((seg.lastBand < seg.firstBand) || (seg.lastBand >= NUM_LEDS)) {
+      continue;
+    }
+
+    uint16_t  bands = seg.lastBand - seg.firstBand + 1;
+    uint32_t  span  = (uint32_t)(seg.lastBand - seg.firstBand) << 8;
+    uint16_t  steps = (seg.numLEDs > 1) ? (seg.numLEDs - 1) : 1;
+
+    for (uint16_t i = 0; i < seg.numLEDs; i++) {
+      uint16_t  led = seg.firstLED + (seg.mirror ? (seg.numLEDs - 1 - i) : i);
+
+      if ((seg.channel < NUM_LED_CHANNELS) && (led < ledChannels[seg.channel].numLEDs) && (led < MAX_CHANNEL_LEDS)) {
+        if (seg.numLEDs < bands) {
+          // share the bands out, every one to exactly one LED
+          uint16_t  first = seg.firstBand + (uint16_t)(((uint32_t)bands * i) / seg.numLEDs);
+          uint16_t  last  = seg.firstBand + (uint16_t)(((uint32_t)bands * (i + 1)) / seg.numLEDs) - 1;
+          pixelSource[seg.channel][led] = first << 8;
+          pixelRun[seg.channel][led]    = (uint8_t)min(last - first, 255);
+        } else {
+          pixelSource[seg.channel][led] = (seg.firstBand << 8) + (uint16_t)((span * i) / steps);
+        }
+      }
+    }
+  }
+}
+
+// Find the physical LED at a logical frame position (in pixels, with a fraction) on each segment
+// that covers it.  A segment covers its bands from the start of firstBand to the end of lastBand.
+// Returns the number of spots found.
+int   layoutSpots(float position, LedSpot *spots, int maxSpots) {
+  int   found = 0;
+
+  for (int s = 0; (s < NUM_LED_SEGMENTS) && (found < maxSpots); s++) {
+    const LedSegment &seg = ledSegments[s];
+    if ((seg.lastBand < seg.firstBand) || (seg.numLEDs == 0) || (seg.channel >= NUM_LED_CHANNELS) ||
+        (position < seg.firstBand) || (position >= seg.lastBand + 1)) {
+      continue;
+    }
+
+    // the same places initLEDLayout() puts the bands
+    float     offset = position - seg.firstBand;
+    uint16_t  bands  = seg.lastBand - seg.firstBand + 1;
+    int       i;
+
+    if ((seg.numLEDs < bands) || (bands == 1)) {
+      i = (int)((offset * seg.numLEDs) / bands);
+    } else {
+      i = (int)(((offset * (seg.numLEDs - 1)) / (bands - 1)) + 0.5f);
+    }
+    if (i >= seg.numLEDs) {
+      i = seg.numLEDs - 1;
+    }
+
+    uint16_t  led = seg.firstLED + (seg.mirror ? (seg.numLEDs - 1 - i) : i);
+    if ((led < ledChannels[seg.channel].numLEDs) && (led < MAX_CHANNEL_LEDS)) {
+      spots[found].channel = seg.channel;
+      spots[found].led     = led;
+      found++;
+    }
+  }
+  return found;
+}
+
+// Expand the logical frame into APA102 LED frames for one channel.
+// frame[] must have one spare pixel past the end, since the last position blends with it at zero weight.
+// spots[] (or NULL) holds one pixel per physical LED.  Where it isn't black, it replaces the frame.
+void  renderChannel(int channel, const CRGB *frame, const CRGB *spots, uint8_t *dest, uint8_t header) {
+  const uint16_t *source = pixelSource[channel];
+  const uint8_t  *run    = pixelRun[channel];
+  uint16_t        numLEDs = min(ledChannels[channel].numLEDs, (uint16_t)MAX_CHANNEL_LEDS);
+
+  for (uint16_t l = 0; l < numLEDs; l++) {
+    uint16_t  from = source[l];
+    uint8_t   r, g, b;
+
+    if (spots && (spots[l].r | spots[l].g | spots[l].b)) {
+      r = spots[l].r;
+      g = spots[l].g;
+      b = spots[l].b;
+    } else if (from == LED_UNMAPPED) {
+      r = g = b = 0;
+    } else if (run[l]) {
+      // brightest of the bands this LED covers
+      const CRGB *p = frame + (from >> 8);
+      r = p->r;
+      g = p->g;
+      b = p->b;
+
+      for (uint8_t n = 0; n < run[l]; n++) {
+        p++;
+        r = max(r, p->r);
+        g = max(g, p->g);
+        b = max(b, p->b);
+      }
+    } else {
+      const CRGB &lo = frame[from >> 8];
+      const CRGB &hi = frame[(from >> 8) + 1];
+      int         w  = from & 0xFF;
+
+      r = lo.r + (((hi.r - lo.r) * w) >> 8);
+      g = lo.g + (((hi.g - lo.g) * w) >> 8);
+      b = lo.b + (((hi.b - lo.b) * w) >> 8);
+    }
+
+    *dest++ = header;
+    *dest++ = b;
+    *dest++ = g;
+    *dest++ = r;
+  }
+}
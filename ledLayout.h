@@ -0,0 +1,55 @@
+/*
+  LED Layout.
+
+  The display functions draw a logical frame of NUM_LEDS pixels in band order (leds[]).
+  The layout maps that frame onto the physical strips using the LED_CHANNELS and LED_SEGMENTS
+  tables in devconf.h.  A segment can stretch its run of bands over more LEDs (with linear
+  interpolation between bands), or shrink it onto fewer (each LED shows the brightest of the bands
+  it covers), and can be mirrored.  A run always goes from firstBand up to lastBand:  use mirror to
+  reverse it.
+
+  The mapping is worked out once by initLEDLayout(), so expanding a frame is a table lookup per LED.
+
+  Displays that place things at a position (eg: the Fireworks balls) can draw at the strips' own
+  resolution instead:  layoutSpots() finds the physical LED at a fractional logical position on
+  every segment that covers it, and renderChannel() lays those spots over the expanded frame.
+*/
+
+#ifndef ledLayout_h /* Prevent loading library twice */
+#define ledLayout_h
+
+#include "devconf.h"
+
+#define  FASTLED_INTERNAL
+#include "FastLED.h"
+
+#define LED_UNMAPPED        0xFFFF                // LED not covered by any segment
+
+struct LedChannel {
+  uint8_t   dataPin;
+  uint8_t   clockPin;
+  uint16_t  numLEDs;
+};
+
+struct LedSegment {
+  uint8_t   channel;
+  uint16_t  firstLED;
+  uint16_t  numLEDs;
+  uint8_t   firstBand;
+  uint8_t   lastBand;
+  bool      mirror;
+};
+
+struct LedSpot {
+  uint8_t   channel;
+  uint16_t  led;
+};
+
+extern const LedChannel ledChannels[NUM_LED_CHANNELS];
+extern const LedSegment ledSegments[NUM_LED_SEGMENTS];
+
+void  initLEDLayout();
+int   layoutSpots(float position, LedSpot *spots, int maxSpots);
+void  renderChannel(int channel, const CRGB *frame, const CRGB *spots, uint8_t *dest, uint8_t header);
+
+#endif
@@ -0,0 +1,212 @@
+/*
+  LED Output stage.
+  See ledOutput.h
+*/
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "ledOutput.h"
+
+// ======================================================================================================
+
+CRGB      leds[NUM_LEDS + 1];               // Back frame.  Written by the display functions.  Last pixel is always black.
+CRGB      heldFrame[NUM_LEDS + 1];          // Copy of a frame handed over while the previous one was still being sent
+CRGB      ledSpots[NUM_LED_CHANNELS][MAX_CHANNEL_LEDS];   // Back spots, at physical resolution.  Written by setLEDSpot().
+CRGB      heldSpots[NUM_LED_CHANNELS][MAX_CHANNEL_LEDS];  // Copy of the spots of the held frame
+bool      spotsUsed     = false;            // ledSpots[] has been drawn into since it was last cleared
+bool      heldSpotsUsed = false;
+
+uint8_t   txBuffer[NUM_LED_CHANNELS][LED_TX_BYTES(MAX_CHANNEL_LEDS)];  // Front frames.  Encoded APA102 data being transmitted.
+uint16_t  txBytes[NUM_LED_CHANNELS];        // Length of each channel's transmission
+uint16_t  txLongest = 0;                    // Length of the longest transmission
+IntervalTimer ledTimer;
+
+volatile bool      txBusy        = false;
+volatile uint16_t  txNext        = 0;
+volatile uint32_t  framesSent    = 0;
+bool      framePending  = false;
+uint32_t  framesDropped = 0;
+
+FrameStamp  backStamp;                      // Latency stamp of the back frame
+FrameStamp  heldStamp;                      // Latency stamp of the held frame
+FrameStamp  txStamp;                        // Latency stamp of the frame being transmitted
+
+// ======================================================================================================
+// Transmit functions
+// ======================================================================================================
+
+// Clock byte number 'index' out to every channel that still has data, MSB first.
+static inline void  clockOutByte(uint16_t index) {
+  for (uint8_t mask = 0x80; mask; mask >>= 1) {
+    for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+      if (index < txBytes[ch]) {
+        digitalWriteFast(ledChannels[ch].dataPin, (txBuffer[ch][index] & mask) ? HIGH : LOW);
+      }
+    }
+    delayNanoseconds(LED_CLOCK_HALF_NS);
+
+    for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+      if (index < txBytes[ch]) {
+        digitalWriteFast(ledChannels[ch].clockPin, HIGH);
+      }
+    }
+    delayNanoseconds(LED_CLOCK_HALF_NS);
+
+    for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+      digitalWriteFast(ledChannels[ch].clockPin, LOW);
+    }
+  }
+}
+
+// Timer interrupt.  Send the next burst and stop the timer when the frame is complete.
+void  ledTxISR() {
+  uint16_t  next = txNext;
+  uint16_t  last = next + LED_TX_BURST_BYTES;
+
+  if (last > txLongest) {
+    last = txLongest;
+  }
+
+  while (next < last) {
+    clockOutByte(next++);
+  }
+  txNext = next;
+
+  if (next >= txLongest) {
+    ledTimer.end();
+    if (txStamp.valid) {
+      txStamp.shownUs = latencyNow();
+      recordLatency(txStamp);
+    }
+    framesSent++;
+    txBusy = false;
+  }
+}
+
+// Encode a frame into the transmit buffers and start clocking them out.
+void  startFrame(const CRGB *frame, CRGB (*spots)[MAX_CHANNEL_LEDS], FrameStamp &stamp) {
+  // start and end frames are constant, so only the pixels need encoding.
+  for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+    renderChannel(ch, frame, spots ? spots[ch] : NULL, txBuffer[ch] + LED_START_BYTES, 0xE0 | LED_GLOBAL_BRIGHTNESS);
+  }
+
+  txStamp = stamp;
+  stamp.valid = false;
+
+  framePending = false;
+  txNext = 0;
+  txBusy = true;
+  ledTimer.begin(ledTxISR, LED_TX_INTERVAL_US);
+}
+
+// ======================================================================================================
+// Public functions
+// ======================================================================================================
+
+void  initLEDOutput() {
+  initLEDLayout();
+
+  txLongest = 0;
+  for (int ch = 0; ch < NUM_LED_CHANNELS; ch++) {
+    pinMode(ledChannels[ch].dataPin,  OUTPUT);
+    pinMode(ledChannels[ch].clockPin, OUTPUT);
+    digitalWriteFast(ledChannels[ch].clockPin, LOW);
+
+    txBytes[ch] = LED_TX_BYTES(min(ledChannels[ch].numLEDs, (uint16_t)MAX_CHANNEL_LEDS));
+    if (txBytes[ch] > txLongest) {
+      txLongest = txBytes[ch];
+    }
+  }
+
+  memset(txBuffer, 0, sizeof(txBuffer));
+  ledTimer.priority(LED_TX_PRIORITY);
+  memset(&backStamp, 0, sizeof(backStamp));
+  memset(&txStamp, 0, sizeof(txStamp));
+  memset(&heldStamp, 0, sizeof(heldStamp));
+  memset(heldFrame, 0, sizeof(heldFrame));
+  memset(heldSpots, 0, sizeof(heldSpots));
+  spotsUsed = true;
+  clearLEDs();
+}
+
+void  clearLEDs() {
+  memset(leds, 0, sizeof(leds));
+  if (spotsUsed) {
+    memset(ledSpots, 0, sizeof(ledSpots));
+    spotsUsed = false;
+  }
+}
+
+// Light the physical LED at a logical frame position (see layoutSpots()) on every segment covering
+// it, at the strip's own resolution rather than the logical frame's.  Cleared by clearLEDs().
+void  setLEDSpot(float position, const CRGB &color) {
+  LedSpot  spots[NUM_LED_SEGMENTS];
+  int      count = layoutSpots(position, spots, NUM_LED_SEGMENTS);
+
+  for (int s = 0; s < count; s++) {
+    ledSpots[spots[s].channel][spots[s].led] = color;
+  }
+  spotsUsed = spotsUsed || (count > 0);
+}
+
+// Hand the back frame to the transmitter.  Never waits for the strip.
+// If the previous frame is still being sent, this one is copied and held until serviceLEDOutput()
+// can start it, so the display functions are free to draw into leds[] again straight away.
+// A held frame that gets replaced before it starts is counted as dropped.
+void  showLEDs() {
+  if (backStamp.valid) {
+    backStamp.renderUs = latencyNow();
+  }
+
+  if (framePending) {
+    framesDropped++;
+    framePending = false;
+    if (!backStamp.valid) {
+      backStamp = heldStamp;
+    }
+  }
+
+  if (txBusy) {
+    memcpy(heldFrame, leds, sizeof(heldFrame));
+    heldSpotsUsed = spotsUsed;
+    if (spotsUsed) {
+      memcpy(heldSpots, ledSpots, sizeof(heldSpots));
+    }
+    heldStamp = backStamp;
+    backStamp.valid = false;
+    framePending = true;
+  } else {
+    startFrame(leds, spotsUsed ? ledSpots : NULL, backStamp);
+  }
+}
+
+// Attach the latency stamp of new audio that the next frame shows.
+// A held frame keeps its stamp if it is replaced by one without new audio.
+void  stampLEDs(const FrameStamp &stamp) {
+  if (stamp.valid) {
+    backStamp = stamp;
+  }
+}
+
+// Called every pass of the loop() to start any held frame once the transmitter is free.
+void  serviceLEDOutput() {
+  if (framePending && !txBusy) {
+    startFrame(heldFrame, heldSpotsUsed ? heldSpots : NULL, heldStamp);
+  }
+}
+
+bool  ledOutputBusy() {
+  return (txBusy);
+}
+
+bool  ledFramePending() {
+  return (framePending);
+}
+
+uint32_t  ledFramesSent() {
+  return (framesSent);
+}
+
+uint32_t  ledFramesDropped() {
+  return (framesDropped);
+}
@@ -0,0 +1,55 @@
+/*
+  LED Output stage.
+
+  The display functions draw into the back frame (leds[]) and hand it over with showLEDs().
+  The frame is expanded through the LED layout into an APA102 transmit buffer for each channel,
+  which are clocked out by a timer interrupt, a few bytes at a time, so the loop() can analyse and
+  render the next frame while this one is sent.  APA102 pixels latch on the clock, so pauses between
+  bursts do not disturb the strip.  All channels are clocked out together, so the transmit time
+  follows the longest channel rather than the total number of LEDs.
+
+  A frame shown while the previous one is still going out is copied and held until the strip is
+  free, so leds[] can be drawn into again as soon as showLEDs() returns.
+
+  setLEDSpot() draws a pixel at the strips' own resolution (see layoutSpots() in ledLayout.h), over
+  the logical frame.  The spots go out and are held with the frame, and cleared by clearLEDs().
+
+  On the host (host/compat), the timer interrupt runs on a worker thread, and host/ledtool decodes
+  what the pins clock out.
+*/
+
+#ifndef ledOutput_h /* Prevent loading library twice */
+#define ledOutput_h
+
+#include "devconf.h"
+#include "ledLayout.h"
+#include "latencyTrace.h"
+
+#define  FASTLED_INTERNAL
+#include "FastLED.h"
+
+#define LED_TX_INTERVAL_US      20                  // Timer interval between transmit bursts
+#define LED_TX_BURST_BYTES       8                  // Bytes clocked out on each timer interrupt
+#define LED_TX_PRIORITY        224                  // Below the audio library update() priority
+#define LED_CLOCK_HALF_NS       50                  // Half clock period when bit banging
+
+#define LED_GLOBAL_BRIGHTNESS   31                  // APA102 5 bit global brightness (full)
+#define LED_START_BYTES          4                  // 32 bit zero start frame
+#define LED_END_BYTES(n)        (((n) + 15) / 16)   // At least one clock per two pixels
+#define LED_TX_BYTES(n)         (LED_START_BYTES + ((n) * 4) + LED_END_BYTES(n))
+
+extern CRGB  leds[NUM_LEDS + 1];
+
+void      initLEDOutput();
+void      clearLEDs();
+void      setLEDSpot(float position, const CRGB &color);
+void      showLEDs();
+void      stampLEDs(const FrameStamp &stamp);
+void      serviceLEDOutput();
+
+bool      ledOutputBusy();
+bool      ledFramePending();
+uint32_t  ledFramesSent();
+uint32_t  ledFramesDropped();
+
+#endif
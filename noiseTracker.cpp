@@ -0,0 +1,57 @@
+/*
+  Noise Floor Tracker.
+  See noiseTracker.h
+*/
+
+#include <Arduino.h>
+#include "noiseTracker.h"
+
+// Constructor
+NoiseTracker::NoiseTracker() {};
+
+NoiseTracker::NoiseTracker(float *vReal, float *smooth, float *threshold, unsigned short bins) {
+  this->_vReal      = vReal;
+  this->_smooth     = smooth;
+  this->_threshold  = threshold;
+  this->_bins       = bins;
+  this->_minimum    = 0;
+
+  for (unsigned short bin = 0; bin < bins; bin++) {
+    smooth[bin]    = 0;
+    threshold[bin] = 0;
+  }
+};
+
+// Set the starting threshold of a run of bins.  The tracker adapts from there.
+void  NoiseTracker::preset(unsigned short binFirst, unsigned short binLast, float level) {
+  for (unsigned short bin = binFirst; (bin <= binLast) && (bin < _bins); bin++) {
+    _threshold[bin] = level;
+    _smooth[bin]    = level / NOISE_MARGIN;
+  }
+}
+
+// Thresholds never drop below this level.
+void  NoiseTracker::setMinimum(float minimum) {
+  _minimum = minimum;
+}
+
+// Update the floor of every bin from the latest FFT magnitudes.
+void  NoiseTracker::update(void) {
+  const float history = NOISE_SMOOTHING;
+  const float live    = 1.0 - NOISE_SMOOTHING;
+  const float rise    = NOISE_RISE / NOISE_MARGIN;    // threshold back to floor, and grow it
+  const float margin  = NOISE_MARGIN;
+  const float lowest  = _minimum;
+
+  for (unsigned short bin = 0; bin < _bins; bin++) {
+    float smooth = (_smooth[bin] * history) + (_vReal[bin] * live);
+    float floor  = _threshold[bin] * rise;
+
+    if (smooth < floor) {
+      floor = smooth;
+    }
+
+    _smooth[bin]    = smooth;
+    _threshold[bin] = (floor * margin > lowest) ? floor * margin : lowest;
+  }
+}
@@ -0,0 +1,37 @@
+/*
+  Noise Floor Tracker.
+
+  Follows the noise floor of every frequency bin in one FFT range, minimum statistics style:
+  each bin's magnitude is smoothed, the floor drops straight to any new minimum of the smoothed
+  value, and otherwise creeps up slowly, so steady sounds (hum, fans) become part of the floor
+  while music and speech stay above it.
+
+  After each update() the threshold array holds the level each bin must exceed to be counted,
+  ready for band aggregation to use directly.
+*/
+
+#ifndef noiseTracker_h /* Prevent loading library twice */
+#define noiseTracker_h
+
+#define NOISE_SMOOTHING     0.7     // Weight of the history in the smoothed bin magnitude
+#define NOISE_RISE          1.002   // Floor growth per frame when no new minimum is seen (about 1.5 dB/s)
+#define NOISE_MARGIN        1.5     // Threshold is this far above the floor
+
+class NoiseTracker
+{
+public:
+  NoiseTracker();
+  NoiseTracker(float *vReal, float *smooth, float *threshold, unsigned short bins);
+  void  update(void);
+  void  preset(unsigned short binFirst, unsigned short binLast, float level);
+  void  setMinimum(float minimum);
+
+private:
+  float   *_vReal;
+  float   *_smooth;
+  float   *_threshold;
+  unsigned short _bins;
+  float   _minimum;
+};
+
+#endif
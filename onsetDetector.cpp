@@ -0,0 +1,105 @@
+/*
+  Onset Detector.
+  See onsetDetector.h
+*/
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "onsetDetector.h"
+
+// ======================================================================================================
+
+const uint8_t rangeFirst[ONSET_RANGES] = { 0, NUM_LO_BANDS, NUM_LO_BANDS + NUM_MD_BANDS };
+const uint8_t rangeLast[ONSET_RANGES]  = { NUM_LO_BANDS - 1, NUM_LO_BANDS + NUM_MD_BANDS - 1, NUM_BANDS - 1 };
+
+uint32_t  lastBands[NUM_BANDS];                         // Previous band frame
+float     fluxHistory[ONSET_RANGES][ONSET_HISTORY];     // Recent flux of each range
+float     fluxSum[ONSET_RANGES];                        // Running total of the history
+uint8_t   fluxIndex = 0;
+uint32_t  lastOnsetUs[ONSET_RANGES];
+
+OnsetEvent onsetQueue[ONSET_QUEUE];
+uint8_t   onsetHead  = 0;                               // Next event to read
+uint8_t   onsetCount = 0;
+uint32_t  droppedOnsets = 0;
+
+// ======================================================================================================
+
+void  initOnsets() {
+  memset(lastBands,   0, sizeof(lastBands));
+  memset(fluxHistory, 0, sizeof(fluxHistory));
+  memset(fluxSum,     0, sizeof(fluxSum));
+  memset(lastOnsetUs, 0, sizeof(lastOnsetUs));
+  fluxIndex = 0;
+  droppedOnsets = 0;
+  clearOnsets();
+}
+
+// Throw away any events that have not been read.
+void  clearOnsets() {
+  onsetHead  = 0;
+  onsetCount = 0;
+}
+
+void  queueOnset(const OnsetEvent &event) {
+  if (onsetCount == ONSET_QUEUE) {
+    onsetHead = (onsetHead + 1) % ONSET_QUEUE;
+    onsetCount--;
+    droppedOnsets++;
+  }
+  onsetQueue[(onsetHead + onsetCount) % ONSET_QUEUE] = event;
+  onsetCount++;
+}
+
+// Run one band frame through the detector.  Returns a bit mask of the ranges with an onset.
+uint8_t runOnsets(const uint32_t * bandValues, uint32_t timeUs) {
+  uint8_t   onsets = 0;
+
+  for (int r = 0; r < ONSET_RANGES; r++) {
+    float   flux = 0;
+
+    // half wave rectified difference from the last frame
+    for (int b = rangeFirst[r]; b <= rangeLast[r]; b++) {
+      if (bandValues[b] > lastBands[b]) {
+        flux += (float)(bandValues[b] - lastBands[b]);
+      }
+      lastBands[b] = bandValues[b];
+    }
+
+    float threshold = max((fluxSum[r] / ONSET_HISTORY) * ONSET_RATIO, (float)ONSET_MIN_FLUX);
+
+    if ((flux > threshold) && ((timeUs - lastOnsetUs[r]) >= ONSET_HOLDOFF_US)) {
+      OnsetEvent event;
+      event.timeUs    = timeUs;
+      event.range     = r;
+      event.firstBand = rangeFirst[r];
+      event.lastBand  = rangeLast[r];
+      event.strength  = flux / threshold;
+      queueOnset(event);
+
+      lastOnsetUs[r] = timeUs;
+      onsets |= (1 << r);
+    }
+
+    fluxSum[r] += flux - fluxHistory[r][fluxIndex];
+    fluxHistory[r][fluxIndex] = flux;
+  }
+
+  fluxIndex = (fluxIndex + 1) % ONSET_HISTORY;
+  return onsets;
+}
+
+// Take the oldest event from the queue.  Returns false if there are none.
+bool  readOnset(OnsetEvent &event) {
+  if (onsetCount == 0) {
+    return false;
+  }
+  event = onsetQueue[onsetHead];
+  onsetHead = (onsetHead + 1) % ONSET_QUEUE;
+  onsetCount--;
+  return true;
+}
+
+uint32_t onsetsDropped() {
+  return droppedOnsets;
+}
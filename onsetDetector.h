@@ -0,0 +1,41 @@
+/*
+  Onset Detector.
+
+  Finds the start of new sounds (drum hits, plucks, attacks) in each FFT range from consecutive
+  band frames.  The spectral flux of a range is the sum of how much each of its bands rose since
+  the previous frame (falls are ignored).  An onset is reported when the flux jumps well above its
+  own recent average, so the detector follows the loudness of the music.
+
+  Only the previous frame and a short flux history per range are kept, so each frame costs one
+  pass over the bands.  Onsets are queued as events with the arrival time of their audio, for the
+  display modes to collect with readOnset().
+*/
+
+#ifndef onsetDetector_h /* Prevent loading library twice */
+#define onsetDetector_h
+
+#include <Arduino.h>
+#include "devconf.h"
+
+#define ONSET_RANGES          3           // LO, MD, HI
+#define ONSET_HISTORY        16           // Frames of flux averaged for the threshold (186 mSec)
+#define ONSET_RATIO         2.0f          // Flux must be this many times its recent average
+#define ONSET_MIN_FLUX       50           // and at least this large
+#define ONSET_HOLDOFF_US  50000           // Minimum time between onsets in one range (fast enough for a 10 Hz roll)
+#define ONSET_QUEUE           8           // Events kept until read.  The oldest is dropped when full.
+
+struct OnsetEvent {
+  uint32_t  timeUs;                       // Arrival time of the newest audio in the frame (latencyNow() clock)
+  uint8_t   range;                        // 0 LO, 1 MD, 2 HI
+  uint8_t   firstBand;                    // Bands of that range
+  uint8_t   lastBand;
+  float     strength;                     // Flux as a multiple of the threshold (1.0 and up)
+};
+
+void  initOnsets();
+void  clearOnsets();
+uint8_t runOnsets(const uint32_t * bandValues, uint32_t timeUs);
+bool  readOnset(OnsetEvent &event);
+uint32_t onsetsDropped();
+
+#endif
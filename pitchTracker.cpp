@@ -0,0 +1,183 @@
+/*
+  Pitch Tracker.
+  See pitchTracker.h
+*/
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "audioAnalyzer.h"
+#include "pitchTracker.h"
+
+// ======================================================================================================
+
+const uint16_t pitchLoBins[NUM_LO_BANDS + 1] = LO_BAND_BINS;
+const uint16_t pitchMdBins[NUM_MD_BANDS + 1] = MD_BAND_BINS;
+const uint16_t pitchHiBins[NUM_HI_BANDS + 1] = HI_BAND_BINS;
+
+uint8_t   bandRange[NUM_BANDS];             // Which FFT range each band comes from
+uint16_t  bandFirstBin[NUM_BANDS];
+uint16_t  bandLastBin[NUM_BANDS];
+float     bandCentreHz[NUM_BANDS];
+
+uint8_t   candidateBand[PITCH_CANDIDATES];  // Loudest bands of this frame, loudest first
+uint32_t  candidateValue[PITCH_CANDIDATES];
+uint8_t   candidateCount = 0;
+uint8_t   loudestBand  = 0;                 // Loudest band of this frame, whatever its level
+uint32_t  loudestValue = 0;
+
+Pitch     trackedPitch;
+uint16_t  heldFrames = 0;
+
+// ======================================================================================================
+
+void  setPitchBands(int first, int count, uint8_t range, const uint16_t *bins, float binHz) {
+  for (int b = 0; b < count; b++) {
+    bandRange[first + b]    = range;
+    bandFirstBin[first + b] = bins[b];
+    bandLastBin[first + b]  = bins[b + 1];
+    bandCentreHz[first + b] = (bins[b] + bins[b + 1]) * 0.5 * binHz;
+  }
+}
+
+void  initPitchTracker() {
+  setPitchBands(0, NUM_LO_BANDS, 0, pitchLoBins, (float)LO_SAMPLING_FREQ / LO_FFT_SAMPLES);
+  setPitchBands(NUM_LO_BANDS, NUM_MD_BANDS, 1, pitchMdBins, (float)MD_SAMPLING_FREQ / MD_FFT_SAMPLES);
+  setPitchBands(NUM_LO_BANDS + NUM_MD_BANDS, NUM_HI_BANDS, 2, pitchHiBins, (float)HI_SAMPLING_FREQ / HI_FFT_SAMPLES);
+
+  resetPitchTracker();
+}
+
+// Forget the tracked pitch and this frame's candidates, eg: when the analysis stops for silence.
+void  resetPitchTracker() {
+  memset(&trackedPitch, 0, sizeof(trackedPitch));
+  heldFrames = 0;
+  candidateCount = 0;
+  loudestBand  = 0;
+  loudestValue = 0;
+}
+
+// Offer a band as it is summed.  Only the loudest PITCH_CANDIDATES are kept.
+void  addPitchCandidate(uint8_t band, uint32_t value) {
+  int   slot;
+
+  if (value > loudestValue) {
+    loudestBand  = band;
+    loudestValue = value;
+  }
+
+  if ((value < PITCH_MIN_BAND) ||
+      ((candidateCount == PITCH_CANDIDATES) && (value <= candidateValue[PITCH_CANDIDATES - 1]))) {
+    return;
+  }
+
+  if (candidateCount < PITCH_CANDIDATES) {
+    candidateCount++;
+  }
+  for (slot = candidateCount - 1; (slot > 0) && (candidateValue[slot - 1] < value); slot--) {
+    candidateBand[slot]  = candidateBand[slot - 1];
+    candidateValue[slot] = candidateValue[slot - 1];
+  }
+  candidateBand[slot]  = band;
+  candidateValue[slot] = value;
+}
+
+// True if two frequencies are within ratio of each other
+bool  closeTo(float a, float b, float ratio) {
+  return (a > 0) && (b > 0) && (a < b * ratio) && (b < a * ratio);
+}
+
+// Fractional band number of a frequency, starting the search from a nearby band.
+float bandPosition(float hz, int band) {
+  while ((band > 0) && (hz < bandCentreHz[band])) {
+    band--;
+  }
+  while ((band < NUM_BANDS - 1) && (hz >= bandCentreHz[band + 1])) {
+    band++;
+  }
+  if ((band == NUM_BANDS - 1) || (hz < bandCentreHz[band])) {
+    return band;
+  }
+  return band + (hz - bandCentreHz[band]) / (bandCentreHz[band + 1] - bandCentreHz[band]);
+}
+
+// Refine this frame's candidates and update the tracked pitch.
+void  runPitchTracker(AudioAnalyzeFFT &analyzer, uint32_t timeUs) {
+  float     hz[PITCH_CANDIDATES];
+  float     mag[PITCH_CANDIDATES];
+  bool      found[PITCH_CANDIDATES];
+  int       best = -1;
+
+  for (int c = 0; c < candidateCount; c++) {
+    uint8_t b = candidateBand[c];
+    found[c] = analyzer.readPeak(bandRange[b], bandFirstBin[b], bandLastBin[b], hz[c], mag[c]);
+    if (found[c] && (best < 0)) {
+      best = c;
+    }
+  }
+
+  trackedPitch.timeUs  = timeUs;
+  trackedPitch.loudest = loudestBand;
+  loudestBand  = 0;
+  loudestValue = 0;
+
+  if (best < 0) {
+    // nothing to follow.  Let the confidence fade.
+    trackedPitch.confidence *= 0.5;
+    if (trackedPitch.confidence < 0.05) {
+      trackedPitch.confidence = 0;
+      trackedPitch.frequency  = 0;
+    }
+    heldFrames = 0;
+    candidateCount = 0;
+    return;
+  }
+
+  // keep following the current pitch if it is still reasonably strong
+  for (int c = 0; c < candidateCount; c++) {
+    if (found[c] && closeTo(hz[c], trackedPitch.frequency, PITCH_TRACK_RATIO) &&
+        (candidateValue[c] >= candidateValue[0] * PITCH_TRACK_LEVEL)) {
+      best = c;
+      break;
+    }
+  }
+
+  // prefer the fundamental to its first harmonic
+  for (int c = 0; c < candidateCount; c++) {
+    if (found[c] && closeTo(hz[c] * 2, hz[best], PITCH_TRACK_RATIO) &&
+        (candidateValue[c] >= candidateValue[best] * PITCH_OCTAVE_LEVEL)) {
+      best = c;
+      break;
+    }
+  }
+
+  // share of the candidates' level that belongs to this peak (including the bands it spills into)
+  uint32_t  total = 0;
+  uint32_t  own   = 0;
+  for (int c = 0; c < candidateCount; c++) {
+    total += candidateValue[c];
+    if (abs((int)candidateBand[c] - (int)candidateBand[best]) <= 1) {
+      own += candidateValue[c];
+    }
+  }
+  float dominance = (float)own / total;
+
+  if (closeTo(hz[best], trackedPitch.frequency, PITCH_TRACK_RATIO)) {
+    trackedPitch.frequency += (hz[best] - trackedPitch.frequency) * PITCH_SMOOTHING;
+    if (heldFrames < PITCH_SETTLE_FRAMES) {
+      heldFrames++;
+    }
+  } else {
+    trackedPitch.frequency = hz[best];
+    heldFrames = 1;
+  }
+
+  trackedPitch.magnitude  = mag[best];
+  trackedPitch.band       = candidateBand[best];
+  trackedPitch.position   = bandPosition(trackedPitch.frequency, trackedPitch.band);
+  trackedPitch.confidence = constrain((dominance - 0.34f) / 0.5f, 0.0f, 1.0f) * heldFrames / PITCH_SETTLE_FRAMES;
+  candidateCount = 0;
+}
+
+const Pitch &readPitch() {
+  return trackedPitch;
+}
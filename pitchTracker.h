@@ -0,0 +1,49 @@
+/*
+  Pitch Tracker.
+
+  Follows the main pitch of the sound, to a fraction of an FFT bin, for Tone mode.
+
+  fillBands() hands each band to addPitchCandidate() as it is summed, and the few loudest are kept.
+  runPitchTracker() then looks for the peak bin in just those bands, refines it by fitting a parabola
+  through the peak and its neighbours (arduinoFFT_float::MajorPeak), and picks the candidate that
+  continues the pitch being tracked, or else the loudest.  A candidate an octave below the winner
+  that is nearly as strong is taken instead, to avoid locking onto a harmonic.  The loudest band of
+  the frame is kept as well, candidate or not, for when there is no pitch to show.
+
+  The confidence (0 to 1) is high for a single clear peak that has held its pitch for a few frames,
+  and falls away for noise, chords and silence.
+*/
+
+#ifndef pitchTracker_h /* Prevent loading library twice */
+#define pitchTracker_h
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "audioAnalyzer.h"
+
+#define PITCH_CANDIDATES        3           // Loudest bands refined each frame
+#define PITCH_MIN_BAND         10           // Bands quieter than this are not candidates
+#define PITCH_TRACK_RATIO    1.06           // A candidate within a semitone continues the tracked pitch
+#define PITCH_TRACK_LEVEL     0.5           // ... if it is at least this fraction of the loudest candidate
+#define PITCH_OCTAVE_LEVEL    0.6           // Prefer the octave below if it is this fraction as strong
+#define PITCH_SMOOTHING       0.5           // Weight of each new frame in a continuing pitch
+#define PITCH_SETTLE_FRAMES     4           // Frames a pitch must hold for full confidence
+#define PITCH_MIN_CONFIDENCE  0.3           // Below this, Tone mode shows the loudest band instead
+
+struct Pitch {
+  float     frequency;                      // Hz, 0 if there is no pitch
+  float     magnitude;                      // Interpolated peak magnitude
+  float     position;                       // Fractional band number of the frequency
+  uint8_t   band;                           // Band the peak was found in
+  uint8_t   loudest;                        // Loudest band of the frame (0 if every band is 0)
+  float     confidence;                     // 0 to 1
+  uint32_t  timeUs;                         // Arrival time of the audio (latencyNow() clock)
+};
+
+void  initPitchTracker();
+void  resetPitchTracker();
+void  addPitchCandidate(uint8_t band, uint32_t value);
+void  runPitchTracker(AudioAnalyzeFFT &analyzer, uint32_t timeUs);
+const Pitch &readPitch();
+
+#endif
@@ -0,0 +1,42 @@
+/*
+  Analysis Quality Plan.
+
+  The analyser's quality steps, and what each one does to a frame.  When the analysis runs over its
+  budget it steps down, one step at a time (see AudioAnalyzeFFT::adaptQuality()).
+
+  Shared by the analyser (audioAnalyzer.cpp) and the host side tools (host/), so this file must
+  only depend on the standard C headers.
+*/
+
+#ifndef qualityPlan_h /* Prevent loading library twice */
+#define qualityPlan_h
+
+#include <stdint.h>
+
+// Analysis quality steps, from best to cheapest.  Each step includes the ones before it.
+#define QUALITY_FULL          0       // All ranges every frame
+#define QUALITY_ALTERNATE     1       // LO and MD ranges are recomputed on alternate frames
+#define QUALITY_RECTANGLE     2       // No window weighting
+#define QUALITY_HALF_HI       3       // HI range uses a half size FFT of the newest samples
+#define QUALITY_LEVELS        4
+
+// What to do for one frame.
+struct QualityPlan {
+  bool      window;                   // Apply the window weights
+  bool      doLO;                     // Recompute the LO range (otherwise it keeps its last magnitudes)
+  bool      doMD;                     // Recompute the MD range
+  bool      halfHI;                   // Half size HI FFT.  Read its bands with sumShiftedBand(), shift 1
+};
+
+// The plan for a frame at a quality step.  oddFrame alternates from one analysed frame to the next.
+static inline QualityPlan qualityPlan(uint8_t quality, bool oddFrame) {
+  QualityPlan plan;
+
+  plan.window = (quality < QUALITY_RECTANGLE);
+  plan.doLO   = (quality < QUALITY_ALTERNATE) || oddFrame;
+  plan.doMD   = (quality < QUALITY_ALTERNATE) || !oddFrame;
+  plan.halfHI = (quality >= QUALITY_HALF_HI);
+  return plan;
+}
+
+#endif
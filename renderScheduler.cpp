@@ -0,0 +1,139 @@
+/*
+  Render Scheduler.
+  See renderScheduler.h
+*/
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "ledOutput.h"
+#include "renderScheduler.h"
+
+// ======================================================================================================
+
+uint32_t  startValues[NUM_BANDS];       // What was showing when the newest frame arrived
+uint32_t  targetValues[NUM_BANDS];      // Newest analysis frame
+uint32_t  shownValues[NUM_BANDS];       // Last rendered values
+FrameStamp targetStamp;                 // Latency stamp of the newest analysis frame
+
+uint32_t  publishUs       = 0;
+uint32_t  frameIntervalUs = ANALYSIS_INTERVAL_US;
+uint32_t  nextRenderUs    = 0;
+bool      frameRendered   = true;
+bool      renderIdle      = false;      // Not rendering on purpose.  Resync on the next renderDue().
+
+uint32_t  renderCount     = 0;
+uint32_t  analysisCount   = 0;
+uint32_t  rateStartMs     = 0;
+RenderStats renderStats;
+
+// ======================================================================================================
+
+void  updateRates() {
+  uint32_t  elapsed = millis() - rateStartMs;
+
+  if (elapsed >= RATE_REPORT_MS) {
+    renderStats.renderRate   = (float)renderCount   * 1000.0 / elapsed;
+    renderStats.analysisRate = (float)analysisCount * 1000.0 / elapsed;
+    renderCount   = 0;
+    analysisCount = 0;
+    rateStartMs  += elapsed;
+  }
+}
+
+void  initRenderScheduler() {
+  memset(startValues,  0, sizeof(startValues));
+  memset(targetValues, 0, sizeof(targetValues));
+  memset(shownValues,  0, sizeof(shownValues));
+  memset(&renderStats, 0, sizeof(renderStats));
+  memset(&targetStamp, 0, sizeof(targetStamp));
+
+  publishUs       = micros();
+  nextRenderUs    = publishUs;
+  frameIntervalUs = ANALYSIS_INTERVAL_US;
+  frameRendered   = true;
+  renderIdle      = false;
+  renderCount     = 0;
+  analysisCount   = 0;
+  rateStartMs     = millis();
+}
+
+// A new analysis frame is ready.  Start the glide from what is showing now.
+void  publishBands(uint32_t * bandValues, const FrameStamp &stamp) {
+  uint32_t  now = micros();
+
+  if (!frameRendered) {
+    renderStats.staleFrames++;
+  }
+
+  // follow the real analysis interval, ignoring long gaps (mode changes, VU mode)
+  if ((now - publishUs) < (2 * ANALYSIS_INTERVAL_US)) {
+    frameIntervalUs = now - publishUs;
+  }
+  publishUs = now;
+
+  memcpy(startValues,  shownValues, sizeof(startValues));
+  memcpy(targetValues, bandValues,  sizeof(targetValues));
+  targetStamp = stamp;
+  frameRendered = false;
+  analysisCount++;
+}
+
+// Return true when it's time to render.  Missed slots are skipped, not caught up.
+bool  renderDue() {
+  uint32_t  now = micros();
+
+  updateRates();
+
+  if (renderIdle) {
+    renderIdle   = false;
+    nextRenderUs = now;
+  }
+
+  if ((int32_t)(now - nextRenderUs) < 0) {
+    return (false);
+  }
+
+  nextRenderUs += RENDER_INTERVAL_US;
+  if ((int32_t)(now - nextRenderUs) >= 0) {
+    renderStats.droppedRenders += (now - nextRenderUs) / RENDER_INTERVAL_US + 1;
+    nextRenderUs = now + RENDER_INTERVAL_US;
+  }
+
+  // Don't render over a frame the LED output hasn't even started on.
+  if (ledFramePending()) {
+    renderStats.droppedRenders++;
+    return (false);
+  }
+
+  return (true);
+}
+
+// The loop() is not rendering for now.  The missed slots are not counted as dropped.
+void  idleRenders() {
+  renderIdle = true;
+  updateRates();
+}
+
+// Fill renderValues with the band values for this moment, and stamp with the newest frame they include.
+void  interpolateBands(uint32_t * renderValues, FrameStamp &stamp) {
+  uint32_t  elapsed = micros() - publishUs;
+  uint32_t  frac    = (elapsed >= frameIntervalUs) ? 256 : ((elapsed << 8) / frameIntervalUs);
+
+  for (int band = 0; band < NUM_BANDS; band++) {
+    uint32_t  from = startValues[band];
+    uint32_t  to   = targetValues[band];
+
+    renderValues[band] = (to >= from) ? to : from - (((from - to) * frac) >> 8);
+  }
+
+  memcpy(shownValues, renderValues, sizeof(shownValues));
+  // only the first render of a frame carries its stamp, later ones are not new audio.
+  stamp = targetStamp;
+  targetStamp.valid = false;
+  frameRendered = true;
+  renderCount++;
+}
+
+void  readRenderStats(RenderStats &stats) {
+  stats = renderStats;
+}
@@ -0,0 +1,41 @@
+/*
+  Render Scheduler.
+
+  Runs the display at its own rate (RENDER_RATE_HZ) instead of once per analysis frame.
+  Each new analysis frame is published here, and every render interpolates from what was last
+  shown towards the newest frame.  Rising bands are shown immediately so transients are not delayed,
+  falling bands glide down over one analysis interval.
+
+  Renders that fall more than one interval behind, or would only replace a frame the LED output
+  has not started sending yet, are skipped rather than queued.  While the loop() is not rendering on
+  purpose (the display is dark, or VU mode draws for itself) it calls idleRenders(), and rendering
+  resumes on the next slot without counting the idle time as dropped renders.
+*/
+
+#ifndef renderScheduler_h /* Prevent loading library twice */
+#define renderScheduler_h
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "latencyTrace.h"
+
+#define RENDER_RATE_HZ        120                               // Target display update rate
+#define RENDER_INTERVAL_US    (1000000 / RENDER_RATE_HZ)
+#define ANALYSIS_INTERVAL_US  11610                             // Expected time between analysis frames
+#define RATE_REPORT_MS        1000                              // Interval for recalculating the rates
+
+struct RenderStats {
+  float     renderRate;             // Renders per second
+  float     analysisRate;           // Analysis frames per second
+  uint32_t  droppedRenders;         // Render slots skipped because we were late or the LEDs were busy
+  uint32_t  staleFrames;            // Analysis frames replaced before they were ever rendered
+};
+
+void  initRenderScheduler();
+void  publishBands(uint32_t * bandValues, const FrameStamp &stamp);
+bool  renderDue();
+void  idleRenders();
+void  interpolateBands(uint32_t * renderValues, FrameStamp &stamp);
+void  readRenderStats(RenderStats &stats);
+
+#endif
@@ -0,0 +1,116 @@
+/*
+  Non Volatile Settings Store.
+  See settings.h
+*/
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "devconf.h"
+#include "settings.h"
+
+// ======================================================================================================
+
+uint8_t   settingValues[NUM_SETTINGS];
+uint8_t   record[SETTINGS_RECORD_BYTES];      // Record being written
+uint16_t  sequence      = 0;                  // Sequence number of the newest saved record
+uint8_t   slot          = 0;                  // Slot of the newest saved record
+int8_t    writeIndex    = -1;                 // Next record byte to write.  -1 when idle.
+bool      dirty         = false;
+uint32_t  changedMs     = 0;
+uint32_t  firstChangeMs = 0;
+
+// ======================================================================================================
+
+int  slotAddress(uint8_t s) {
+  return (SETTINGS_ADDRESS + (s * SETTINGS_RECORD_BYTES));
+}
+
+uint8_t  recordCheck(const uint8_t *rec) {
+  uint8_t  check = SETTINGS_CHECK_SEED;
+
+  for (int i = 0; i < NUM_SETTINGS; i++) {
+    check += rec[i];
+  }
+  check += rec[NUM_SETTINGS + 1];
+  check += rec[NUM_SETTINGS + 2];
+  return (check);
+}
+
+// Find the newest valid record.  Fall back to the original fixed addresses if there are none.
+void  initSettings() {
+  uint8_t   rec[SETTINGS_RECORD_BYTES];
+  bool      found = false;
+
+  for (uint8_t s = 0; s < SETTINGS_SLOTS; s++) {
+    int address = slotAddress(s);
+    for (int i = 0; i < SETTINGS_RECORD_BYTES; i++) {
+      rec[i] = EEPROM.read(address + i);
+    }
+
+    if (rec[NUM_SETTINGS] == recordCheck(rec)) {
+      uint16_t seq = rec[NUM_SETTINGS + 1] | (rec[NUM_SETTINGS + 2] << 8);
+
+      if (!found || ((int16_t)(seq - sequence) > 0)) {
+        memcpy(settingValues, rec, NUM_SETTINGS);
+        sequence = seq;
+        slot     = s;
+        found    = true;
+      }
+    }
+  }
+
+  if (!found) {
+    settingValues[SETTING_MODE] = EEPROM.read(MODE_ADDRESS);
+    settingValues[SETTING_GAIN] = EEPROM.read(GAIN_ADDRESS);
+    slot = SETTINGS_SLOTS - 1;
+  }
+
+  writeIndex = -1;
+  dirty      = false;
+}
+
+uint8_t  getSetting(int setting) {
+  return (settingValues[setting]);
+}
+
+// Change a setting in RAM.  It gets saved later by serviceSettings().
+void  putSetting(int setting, uint8_t value) {
+  if (settingValues[setting] != value) {
+    settingValues[setting] = value;
+    changedMs = millis();
+    if (!dirty) {
+      firstChangeMs = changedMs;
+      dirty = true;
+    }
+  }
+}
+
+// Called every pass of the loop().  Writes at most one EEPROM byte.
+void  serviceSettings() {
+  uint32_t  now = millis();
+
+  if (writeIndex < 0) {
+    if (!dirty || (((now - changedMs) < SETTINGS_QUIET_MS) && ((now - firstChangeMs) < SETTINGS_MAX_DELAY_MS))) {
+      return;
+    }
+
+    // snapshot the values into a new record in the next slot
+    sequence++;
+    slot = (slot + 1) % SETTINGS_SLOTS;
+    memcpy(record, settingValues, NUM_SETTINGS);
+    record[NUM_SETTINGS + 1] = sequence & 0xFF;
+    record[NUM_SETTINGS + 2] = sequence >> 8;
+    record[NUM_SETTINGS]     = recordCheck(record);
+    writeIndex = 0;
+    dirty = false;
+  }
+
+  EEPROM.update(slotAddress(slot) + writeIndex, record[writeIndex]);
+  if (++writeIndex >= SETTINGS_RECORD_BYTES) {
+    writeIndex = -1;
+  }
+}
+
+bool  settingsDirty() {
+  return (dirty || (writeIndex >= 0));
+}
@@ -0,0 +1,35 @@
+/*
+  Non Volatile Settings Store.
+
+  Settings are held in RAM.  A changed value is only written to EEPROM once the settings have been
+  quiet for SETTINGS_QUIET_MS (or have been dirty for SETTINGS_MAX_DELAY_MS), and then only one byte
+  is written on each call to serviceSettings(), so the frame loop never stalls on a long write.
+
+  Each save goes into the next of SETTINGS_SLOTS records, so the wear is spread over the whole region.
+  A record is:  mode, gain, ..., checksum, sequence (lo), sequence (hi).
+  The sequence is written last, so a record cut short by a power loss fails its checksum and the
+  previous record is used instead.
+*/
+
+#ifndef settings_h /* Prevent loading library twice */
+#define settings_h
+
+#include <Arduino.h>
+#include "devconf.h"
+
+#define SETTING_MODE            0
+#define SETTING_GAIN            1
+#define NUM_SETTINGS            2
+
+#define SETTINGS_QUIET_MS       10000                   // Save once nothing has changed for this long
+#define SETTINGS_MAX_DELAY_MS   600000                  // Save anyway if changes keep coming for this long
+#define SETTINGS_RECORD_BYTES   (NUM_SETTINGS + 3)
+#define SETTINGS_CHECK_SEED     0x5A
+
+void      initSettings();
+uint8_t   getSetting(int setting);
+void      putSetting(int setting, uint8_t value);
+void      serviceSettings();
+bool      settingsDirty();
+
+#endif
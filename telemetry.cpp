@@ -0,0 +1,94 @@
+/*
+  Band Frame Telemetry.
+  See telemetry.h and telemetryFormat.h
+*/
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "telemetry.h"
+
+// ======================================================================================================
+
+uint8_t   telemetryFrame[TELEMETRY_MAX_FRAME(NUM_BANDS)];
+uint32_t  lastSent[NUM_BANDS];              // Band values of the last frame sent
+uint16_t  telemetrySequence = 0;
+uint16_t  framesToKey       = 0;            // Frames left until the next KEY frame
+uint32_t  sentFrames        = 0;
+uint32_t  droppedFrames     = 0;
+
+// ======================================================================================================
+
+void  initTelemetry() {
+  memset(lastSent, 0, sizeof(lastSent));
+  telemetrySequence = 0;
+  framesToKey       = 0;
+  sentFrames        = 0;
+  droppedFrames     = 0;
+}
+
+// Code the band values against the last frame sent, and write the frame if the port has room for it.
+void  sendTelemetry(uint32_t * bandValues) {
+  bool      key  = (framesToKey == 0);
+  uint8_t  *dest = telemetryFrame + TELEMETRY_HEADER_BYTES;
+  uint32_t  now  = millis();
+  uint16_t  length;
+  uint16_t  crc;
+  int       band = 0;
+
+  while (band < NUM_BANDS) {
+    uint32_t  delta = key ? bandValues[band] : (bandValues[band] - lastSent[band]);
+
+    dest += varintEncode(zigzagEncode((int32_t)delta), dest);
+    band++;
+
+    // a zero is followed by the number of extra zeros
+    if (delta == 0) {
+      uint8_t  zeros = 0;
+      while ((band < NUM_BANDS) && (zeros < 255) &&
+             ((key ? bandValues[band] : (bandValues[band] - lastSent[band])) == 0)) {
+        zeros++;
+        band++;
+      }
+      *dest++ = zeros;
+    }
+  }
+  length = dest - (telemetryFrame + TELEMETRY_HEADER_BYTES);
+
+  telemetryFrame[0]  = TELEMETRY_SYNC0;
+  telemetryFrame[1]  = TELEMETRY_SYNC1;
+  telemetryFrame[2]  = key ? TELEMETRY_KEY : TELEMETRY_DELTA;
+  telemetryFrame[3]  = NUM_BANDS;
+  telemetryFrame[4]  = telemetrySequence & 0xFF;
+  telemetryFrame[5]  = telemetrySequence >> 8;
+  telemetryFrame[6]  = now & 0xFF;
+  telemetryFrame[7]  = (now >> 8) & 0xFF;
+  telemetryFrame[8]  = (now >> 16) & 0xFF;
+  telemetryFrame[9]  = now >> 24;
+  telemetryFrame[10] = length & 0xFF;
+  telemetryFrame[11] = length >> 8;
+
+  crc = telemetryCRC(telemetryFrame + 2, TELEMETRY_HEADER_BYTES - 2 + length);
+  *dest++ = crc & 0xFF;
+  *dest++ = crc >> 8;
+
+  telemetrySequence++;
+
+  if (Serial.availableForWrite() >= (dest - telemetryFrame)) {
+    Serial.write(telemetryFrame, dest - telemetryFrame);
+    memcpy(lastSent, bandValues, sizeof(lastSent));
+    framesToKey = key ? TELEMETRY_KEY_INTERVAL - 1 : framesToKey - 1;
+    sentFrames++;
+  } else {
+    // the decoder no longer has our reference frame, so start again from a KEY frame
+    framesToKey = 0;
+    droppedFrames++;
+  }
+}
+
+uint32_t  telemetrySent() {
+  return (sentFrames);
+}
+
+uint32_t  telemetryDropped() {
+  return (droppedFrames);
+}
@@ -0,0 +1,24 @@
+/*
+  Band Frame Telemetry.
+
+  Streams every analysis frame's band values out of Serial in the compact binary format described
+  in telemetryFormat.h.  A frame is only written if the serial port can take all of it without
+  waiting, otherwise it is dropped (and the next frame is sent as a KEY frame), so the telemetry
+  never slows down the frame loop.
+*/
+
+#ifndef telemetry_h /* Prevent loading library twice */
+#define telemetry_h
+
+#include <Arduino.h>
+#include "devconf.h"
+#include "telemetryFormat.h"
+
+#define TELEMETRY_KEY_INTERVAL    86              // Send a KEY frame at least this often (once a second)
+
+void      initTelemetry();
+void      sendTelemetry(uint32_t * bandValues);
+uint32_t  telemetrySent();
+uint32_t  telemetryDropped();
+
+#endif
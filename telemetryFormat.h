@@ -0,0 +1,85 @@
+/*
+  Band Frame Telemetry Format.
+
+  Shared by the Visual Ear (telemetry.cpp) and the host side decoder (host/telemetryDecoder.cpp),
+  so this file must only depend on the standard C headers.
+
+  Frame layout (multi byte values are little endian):
+    0   sync        0xA5 0x5A
+    2   type        TELEMETRY_KEY or TELEMETRY_DELTA
+    3   bands       number of band values in the frame
+    4   sequence    16 bit, +1 per analysis frame (gaps show dropped frames)
+    6   timeMs      32 bit millis() when the frame was sent
+   10   length      16 bit payload length
+   12   payload     band values as a token list (below)
+   ..   crc         16 bit CRC-CCITT (0xFFFF seed) over type..payload
+
+  Each band is coded as the difference from the same band in the previous frame sent (from zero in a
+  KEY frame), wrapped to 32 bits, zigzag mapped, and written as a LEB128 varint.
+  A zero difference is followed by a one byte count of extra zeros, so runs of unchanged bands
+  cost two bytes.  A KEY frame is sent regularly and after any dropped frame, so a decoder
+  can always resynchronise.
+*/
+
+#ifndef telemetryFormat_h /* Prevent loading library twice */
+#define telemetryFormat_h
+
+#include <stdint.h>
+
+#define TELEMETRY_SYNC0          0xA5
+#define TELEMETRY_SYNC1          0x5A
+#define TELEMETRY_KEY            0x01
+#define TELEMETRY_DELTA          0x02
+#define TELEMETRY_HEADER_BYTES   12
+#define TELEMETRY_CRC_BYTES       2
+#define TELEMETRY_MAX_BANDS     255
+#define TELEMETRY_MAX_PAYLOAD(bands)  ((bands) * 5)
+#define TELEMETRY_MAX_FRAME(bands)    (TELEMETRY_HEADER_BYTES + TELEMETRY_MAX_PAYLOAD(bands) + TELEMETRY_CRC_BYTES)
+
+static inline uint16_t telemetryCRC(const uint8_t *data, uint32_t length) {
+  uint16_t  crc = 0xFFFF;
+
+  while (length--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+    }
+  }
+  return (crc);
+}
+
+static inline uint32_t zigzagEncode(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzagDecode(uint32_t value) {
+  return (int32_t)((value >> 1) ^ (0 - (value & 1)));
+}
+
+// Write a varint and return the number of bytes used.
+static inline int varintEncode(uint32_t value, uint8_t *dest) {
+  int   count = 0;
+
+  while (value >= 0x80) {
+    dest[count++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  dest[count++] = (uint8_t)value;
+  return (count);
+}
+
+// Read a varint and return the number of bytes used (0 if it runs past the end).
+static inline int varintDecode(const uint8_t *src, uint32_t available, uint32_t *value) {
+  uint32_t  result = 0;
+
+  for (uint32_t i = 0; (i < available) && (i < 5); i++) {
+    result |= (uint32_t)(src[i] & 0x7F) << (7 * i);
+    if (!(src[i] & 0x80)) {
+      *value = result;
+      return (i + 1);
+    }
+  }
+  return (0);
+}
+
+#endif
@@ -0,0 +1,195 @@
+/*
+  Zoom FFT.
+  See zoomAnalyzer.h
+*/
+
+#include <Arduino.h>
+#include "zoomAnalyzer.h"
+
+// Modified Bessel function of the first kind, order 0 (for the Kaiser window).
+static double besselI0(double x) {
+  double sum  = 1.0;
+  double term = 1.0;
+
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum  += term;
+  }
+  return sum;
+}
+
+// Constructor
+ZoomAnalyzer::ZoomAnalyzer() {
+  _FFT = arduinoFFT_float(_vReal, _vImag, _weights, ZOOM_FFT_SAMPLES, ZOOM_INPUT_FREQ / ZOOM_DECIMATION, FFT_WIN_TYP_HAMMING);
+  _active = false;
+  _filterDecimation = 0;
+  setZoom(0, ZOOM_DECIMATION);
+}
+
+// Work out the decimation filter:  a Kaiser windowed sinc cut off at half the decimated rate,
+// with a gain of 1 at the centre.  Slow, so only call it while the zoom is stopped.
+// The weights are stored by position within the period, with one weight for each of the
+// outputs a sample is added into (the one finishing this period first).
+void  ZoomAnalyzer::setFilter(unsigned short decimation) {
+  unsigned short length;
+  double  middle;
+  double  sum = 0;
+
+  if (decimation < 1) {
+    decimation = 1;
+  } else if (decimation > ZOOM_MAX_DECIMATION) {
+    decimation = ZOOM_MAX_DECIMATION;
+  }
+  if (decimation == _filterDecimation) {
+    return;
+  }
+
+  length = decimation * ZOOM_FILTER_PERIODS;
+  middle = (length - 1) * 0.5;
+  for (unsigned short n = 0; n < length; n++) {
+    double  t      = (n - middle) / decimation;                       // In decimated samples
+    double  sinc   = (t == 0) ? 1.0 : sin(M_PI * t) / (M_PI * t);
+    double  r      = (n - middle) / (middle + 0.5);
+    double  kaiser = besselI0(ZOOM_FILTER_BETA * sqrt(1.0 - (r * r))) / besselI0(ZOOM_FILTER_BETA);
+    unsigned short period   = n / decimation;
+    unsigned short position = n % decimation;
+
+    _coef[(position * ZOOM_FILTER_PERIODS) + (ZOOM_FILTER_PERIODS - 1 - period)] = sinc * kaiser;
+    sum += sinc * kaiser;
+  }
+  for (unsigned short n = 0; n < length; n++) {
+    _coef[n] /= sum;
+  }
+  _filterDecimation = decimation;
+}
+
+// Start zooming in on centreHz.  The decimated sample rate is ZOOM_INPUT_FREQ / decimation.
+void  ZoomAnalyzer::setZoom(float centreHz, unsigned short decimation) {
+  float phaseStep = twoPi * centreHz / ZOOM_INPUT_FREQ;
+
+  _active     = false;
+  setFilter(decimation);
+  _centreHz   = centreHz;
+  _decimation = _filterDecimation;
+  _position   = 0;
+  _nextSample = 0;
+  _newSamples = 0;
+  _head       = 0;
+
+  _dc     = 0;
+  _oscRe  = 1.0;
+  _oscIm  = 0.0;
+  _stepRe = cos(phaseStep);
+  _stepIm = sin(phaseStep);
+
+  memset(_accRe, 0, sizeof(_accRe));
+  memset(_accIm, 0, sizeof(_accIm));
+  memset(_re,  0, sizeof(_re));
+  memset(_im,  0, sizeof(_im));
+  memset(_mag, 0, sizeof(_mag));
+  _active = (centreHz > 0);
+}
+
+void  ZoomAnalyzer::stop(void) {
+  _active = false;
+  memset(_mag, 0, sizeof(_mag));
+}
+
+bool  ZoomAnalyzer::active(void) {
+  return _active;
+}
+
+// Mix one input sample down to baseband and add it into every filter output it belongs to.
+// The output at _head is complete at the end of the period.
+void  ZoomAnalyzer::addSample(short value) {
+  float x = (float)value - _dc;
+  _dc += x * ZOOM_DC_RATE;
+
+  // multiply by e^(-j wt)
+  float re =  x * _oscRe;
+  float im = -x * _oscIm;
+
+  const float *coef = _coef + (_position * ZOOM_FILTER_PERIODS);
+  for (unsigned short i = 0; i < ZOOM_FILTER_PERIODS; i++) {
+    unsigned short slot = (_head + i) & (ZOOM_FILTER_PERIODS - 1);
+    _accRe[slot] += re * coef[i];
+    _accIm[slot] += im * coef[i];
+  }
+
+  // rotate the oscillator
+  float oscRe = (_oscRe * _stepRe) - (_oscIm * _stepIm);
+  _oscIm      = (_oscRe * _stepIm) + (_oscIm * _stepRe);
+  _oscRe      = oscRe;
+
+  if (++_position == _decimation) {
+    _re[_nextSample] = _accRe[_head];
+    _im[_nextSample] = _accIm[_head];
+    if (++_nextSample == ZOOM_FFT_SAMPLES) {
+      _nextSample = 0;
+    }
+    _newSamples++;
+
+    _accRe[_head] = 0;
+    _accIm[_head] = 0;
+    _head = (_head + 1) & (ZOOM_FILTER_PERIODS - 1);
+    _position = 0;
+
+    // keep the oscillator on the unit circle
+    float gain = (3.0 - ((_oscRe * _oscRe) + (_oscIm * _oscIm))) * 0.5;
+    _oscRe *= gain;
+    _oscIm *= gain;
+  }
+}
+
+// Transform the decimated samples, if any new ones have arrived.  Returns true if the magnitudes changed.
+bool  ZoomAnalyzer::run(float inputScale) {
+  unsigned short fromIndex = _nextSample;
+  const unsigned short half = ZOOM_FFT_SAMPLES >> 1;
+
+  if (!_active || (_newSamples == 0)) {
+    return false;
+  }
+  _newSamples = 0;
+
+  // oldest sample first, with the window weights
+  for (unsigned short i = 0; i < ZOOM_FFT_SAMPLES; i++) {
+    _vReal[i] = _re[fromIndex] * _weights[i] * inputScale;
+    _vImag[i] = _im[fromIndex] * _weights[i] * inputScale;
+    if (++fromIndex == ZOOM_FFT_SAMPLES) {
+      fromIndex = 0;
+    }
+  }
+
+  _FFT.Compute(_vReal, _vImag, ZOOM_FFT_SAMPLES, FFT_FORWARD);
+  _FFT.ComplexToMagnitude(_vReal, _vImag, ZOOM_FFT_SAMPLES);
+
+  // negative frequencies are in the top half of the FFT output.  Put them first.
+  for (unsigned short i = 0; i < half; i++) {
+    _mag[i]        = _vReal[i + half];
+    _mag[i + half] = _vReal[i];
+  }
+  return true;
+}
+
+// Bins outside firstBin() to lastBin() can hold aliases, and read as 0.
+float ZoomAnalyzer::read(unsigned short bin) {
+  return ((bin >= ZOOM_FIRST_BIN) && (bin <= ZOOM_LAST_BIN)) ? _mag[bin] : 0;
+}
+
+// Centre frequency of a bin.
+float ZoomAnalyzer::binFrequency(unsigned short bin) {
+  return _centreHz + (((int)bin - (ZOOM_FFT_SAMPLES >> 1)) * binWidth());
+}
+
+float ZoomAnalyzer::binWidth(void) {
+  return ZOOM_INPUT_FREQ / ((float)_decimation * ZOOM_FFT_SAMPLES);
+}
+
+// First and last bins that are clear of aliases.
+unsigned short ZoomAnalyzer::firstBin(void) {
+  return ZOOM_FIRST_BIN;
+}
+
+unsigned short ZoomAnalyzer::lastBin(void) {
+  return ZOOM_LAST_BIN;
+}
@@ -0,0 +1,83 @@
+/*
+  Zoom FFT.
+
+  High resolution analysis of a narrow band around a chosen centre frequency.  Every input
+  sample is mixed down to baseband with a complex oscillator at the centre frequency, then
+  low pass filtered and decimated.  The decimated complex samples are kept in a circular buffer
+  and transformed with a small complex FFT.
+
+  The decimation filter is a Kaiser windowed sinc, ZOOM_FILTER_PERIODS decimation periods long,
+  cut off at half the decimated rate.  It is worked out when the decimation is set.  Each input
+  sample is added into all of the ZOOM_FILTER_PERIODS outputs it belongs to as it arrives, so no
+  input history is kept.  Anything more than ZOOM_PASS_FRACTION of the decimated rate away from the
+  centre is down by about 75 dB before it can alias into the bins that are kept, and those bins are
+  flat.  The bins further out can hold aliases from the filter's transition band, so read() returns
+  0 for them:  only bins firstBin() to lastBin() are used.
+
+  With a decimation of 256, the 256 point FFT has 0.67 Hz bins, and the bins kept cover +/- 60 Hz
+  around the centre.  The filter delays the zoom by about 8 decimation periods (46 mSec).
+
+  After run(), magnitudes are in frequency order:  bin 0 is (centre - span/2), bin
+  ZOOM_FFT_SAMPLES/2 is the centre.  They are on the same scale as a real FFT of the same size.
+*/
+
+#ifndef zoomAnalyzer_h /* Prevent loading library twice */
+#define zoomAnalyzer_h
+
+#include "arduinoFFT_float.h"
+
+const unsigned short ZOOM_FFT_SAMPLES     =   256;       // Number of decimated samples used to do FFT.
+const unsigned short ZOOM_DECIMATION      =   256;       // Default input samples per decimated sample
+const unsigned short ZOOM_MAX_DECIMATION  =   256;       // Largest decimation the filter table has room for
+const unsigned short ZOOM_FILTER_PERIODS  =    16;       // Filter length in decimation periods (a power of 2)
+const float          ZOOM_FILTER_BETA     =   7.5;       // Kaiser window shape.  About 75 dB of stop band
+const float          ZOOM_PASS_FRACTION   =  0.35;       // Bins kept, each side of the centre, as a fraction of the decimated rate
+const unsigned short ZOOM_FIRST_BIN       = (ZOOM_FFT_SAMPLES / 2) - (unsigned short)(ZOOM_PASS_FRACTION * ZOOM_FFT_SAMPLES);
+const unsigned short ZOOM_LAST_BIN        = (ZOOM_FFT_SAMPLES / 2) + (unsigned short)(ZOOM_PASS_FRACTION * ZOOM_FFT_SAMPLES);
+const float          ZOOM_INPUT_FREQ      = 44100.0;     // Frequency at which microphone is sampled
+const float          ZOOM_DC_RATE         = 1.0 / 4096;  // Weight of each sample in the DC bias estimate
+
+class ZoomAnalyzer
+{
+public:
+  ZoomAnalyzer();
+  void  setFilter(unsigned short decimation);
+  void  setZoom(float centreHz, unsigned short decimation);
+  void  stop(void);
+  bool  active(void);
+  void  addSample(short value);
+  bool  run(float inputScale);
+  float read(unsigned short bin);
+  float binFrequency(unsigned short bin);
+  float binWidth(void);
+  unsigned short firstBin(void);
+  unsigned short lastBin(void);
+
+private:
+  float   _re[ZOOM_FFT_SAMPLES];          // Circular buffer of decimated complex samples
+  float   _im[ZOOM_FFT_SAMPLES];
+  float   _vReal[ZOOM_FFT_SAMPLES];
+  float   _vImag[ZOOM_FFT_SAMPLES];
+  float   _weights[ZOOM_FFT_SAMPLES];
+  float   _mag[ZOOM_FFT_SAMPLES];         // Magnitudes in frequency order
+  float   _coef[ZOOM_MAX_DECIMATION * ZOOM_FILTER_PERIODS];  // Filter weights of each sample, by position in the period
+  float   _accRe[ZOOM_FILTER_PERIODS];    // Outputs being accumulated, the oldest (next to finish) at _head
+  float   _accIm[ZOOM_FILTER_PERIODS];
+
+  arduinoFFT_float _FFT;
+
+  volatile bool _active;
+  float   _centreHz;
+  unsigned short _decimation;
+  unsigned short _filterDecimation;       // Decimation _coef[] was worked out for
+  unsigned short _head;
+  unsigned short _position;               // Input sample number within the current decimation period
+  unsigned short _nextSample;
+  unsigned short _newSamples;             // Decimated samples since the last run()
+
+  float   _dc;
+  float   _oscRe, _oscIm;                 // Oscillator phasor, and its rotation per input sample
+  float   _stepRe, _stepIm;
+};
+
+#endif